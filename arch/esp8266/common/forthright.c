@@ -20,33 +20,581 @@
 * This bootstrapper is kept to an absolute minimum for now.
 */
 
+#include "esp_common.h"
 #include "forthright.h"
 #include "stdio.h"
+#include "fcntl.h"
+#include "unistd.h"
 
 static system_t system;
 
-static char data_stack[DATA_STACK_SIZE];
-static char return_stack[RETURN_STACK_SIZE];
+static int data_stack[( STACK_GUARD + DATA_STACK_SIZE ) / 4];	// the guard first, with the canary at its top
+static int return_stack[( STACK_GUARD + RETURN_STACK_SIZE ) / 4];
 static char input_buffer[INPUT_BUFFER_SIZE];
-static char data_segment[DATA_SEGMENT_SIZE];
 static char word_buffer[MAX_WORD_SIZE];
+static void* dictionary_index[DICTIONARY_INDEX_SIZE];
+static int find_key[MAX_WORD_SIZE / 4];
+
+/* The state of the heap, see forthright_allocate(). Offsets are from the start of the heap. */
+#define HEAP_CLASSES 7				// 16 to 1024 bytes
+#define HEAP_CLASS_MAX ( 16 << ( HEAP_CLASSES - 1 ) )
+#define HEAP_FIRST 16				// no block at 0, which ends the free lists
+
+static struct
+{
+    char* base;
+    int size;
+    int top;					// above the blocks carved so far
+    int used;					// bytes in blocks in use
+    int classes[HEAP_CLASSES];			// free blocks of each size class
+    int large;					// free blocks larger than HEAP_CLASS_MAX
+    int arena_base;				// where MARK-ARENA started, above the top
+    int arena;					// the next free byte in the arena, or 0 if there is none
+} heap;
 
 void forthright()
 {
-    system.data_segment = data_segment;
-    system.data_segment_size = DATA_SEGMENT_SIZE;
+    heap.base = os_malloc( HEAP_SIZE );	// before the data segment takes its half
+    heap.size = heap.base != NULL ? HEAP_SIZE : 0;
+    heap.top = HEAP_FIRST;
 
-    system.data_stack = data_stack;
+    int size = DATA_SEGMENT_SIZE;
+    if( size == 0 ) {
+        int free = system_get_free_heap_size();
+        size = ( free - DATA_SEGMENT_HEAP_RESERVE ) / 2;
+    }
+    if( size < DATA_SEGMENT_CHUNK ) {
+        size = DATA_SEGMENT_CHUNK;
+    }
+    size &= ~3;
+    while( ( system.data_segment = os_malloc( size ) ) == NULL ) {
+        if( size <= DATA_SEGMENT_CHUNK ) {
+            static char message[] = "\nNo heap left for the data segment\n";
+            forthright_debugOut( message, sizeof( message ) - 1 );
+            return;
+        }
+        size -= 1024;
+        if( size < DATA_SEGMENT_CHUNK ) {
+            size = DATA_SEGMENT_CHUNK;
+        }
+    }
+    system.data_segment_size = size;
+    system.segment_start = system.data_segment;
+    system.segment_end = (char*) system.data_segment + size;
+    system.segment_chunk = DATA_SEGMENT_CHUNK;
+    system.rom_dp = (char*) FLASH_MAP + ROM_SEGMENT_FLASH;	// written over again after a reset
+
+    system.data_stack = (char*) data_stack + STACK_GUARD;
     system.data_stack_size = DATA_STACK_SIZE;
+    data_stack[STACK_GUARD / 4 - 1] = STACK_CANARY;
 
-    system.return_stack = return_stack;
+    system.return_stack = (char*) return_stack + STACK_GUARD;
     system.return_stack_size = RETURN_STACK_SIZE;
+    return_stack[STACK_GUARD / 4 - 1] = STACK_CANARY;
 
     system.input_buffer = input_buffer;
     system.input_buffer_size = INPUT_BUFFER_SIZE;
 
     system.word_buffer = word_buffer;
     system.word_buffer_size = MAX_WORD_SIZE;
+    system.find_key = find_key;
+
+    system.dictionary_index = dictionary_index;
+    system.dictionary_index_size = DICTIONARY_INDEX_SIZE;
 
     forthright_start( &system );
 }
+
+/* The saved image, see SAVE-IMAGE in esp8266.S */
+#define IMAGE_MAGIC 0x4d495246		// "FRIM"
+#define FILENAME_SIZE 32		// SPIFFS_OBJ_NAME_LEN
+
+typedef struct
+{
+    int magic;
+    void* builtin;			// the last word not in the data segment
+    char* data_segment;			// where the data segment was
+    int used;				// bytes of it that follow
+    void* latest;
+    int base;
+} image_header_t;
+
+/* Segments chained to the data segment, newest first. DP starts after this. */
+typedef struct segment
+{
+    struct segment* previous;
+    char* end;
+} segment_t;
+
+static int ICACHE_FLASH_ATTR in_data_segment( system_t* system, char* p )
+{
+    char* start = system->data_segment;
+    segment_t* segment;
+    if( p >= start && p < start + system->data_segment_size ) {
+        return 1;
+    }
+    for( segment = system->segments; segment != NULL; segment = segment->previous ) {
+        if( p >= (char*) segment && p < segment->end ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ICACHE_FLASH_ATTR forthright_find_segment( system_t* system )
+{
+    if( system->rom_staging != NULL ) {
+        return;					// DP is in the ROM{ buffer, which is the segment
+    }
+    char* dp = system->dp;
+    segment_t* segment = system->segments;
+    while( segment != NULL && ( dp < (char*) ( segment + 1 ) || dp > segment->end ) ) {
+        segment_t* previous = segment->previous;
+        os_free( segment );
+        segment = previous;
+    }
+    system->segments = segment;
+    if( segment != NULL ) {
+        system->segment_start = segment + 1;
+        system->segment_end = segment->end;
+    } else {
+        system->segment_start = system->data_segment;
+        system->segment_end = (char*) system->data_segment + system->data_segment_size;
+    }
+}
+
+/* Writes the ROM{ buffer to the flash, after what was written before. Cells that were marked as
+   holding addresses (see ROM{ in esp8266.S) and point into the buffer are moved along, and so are
+   LATEST and the (FIND) index.
+   A definition is never split between two buffers, as make_room() only writes it at HEADER, but
+   words in the flash can not be changed, so VARIABLEs in it are constants. Sectors are erased as
+   the writing reaches them, so a reset starts over at ROM_SEGMENT_FLASH.
+*/
+static int ICACHE_FLASH_ATTR rom_commit( system_t* system )
+{
+    char* staging = system->rom_staging;
+    int used = ( (char*) system->dp - staging + 3 ) & ~3;
+    char* rom = system->rom_dp;
+    uint32 flash = rom - (char*) FLASH_MAP;
+    if( flash + used > ROM_SEGMENT_FLASH + ROM_SEGMENT_SECTORS * ROM_SECTOR_SIZE ) {
+        return -1;
+    }
+    int delta = rom - staging;
+    int* cell = (int*) staging;
+    uint8* relocate = (uint8*) staging + ROM_SECTOR_SIZE;
+    int i;
+    for( i = 0; i < used / 4; i++ ) {
+        char* value = (char*) cell[i];
+        if( ( relocate[i / 8] & ( 1 << ( i % 8 ) ) ) && value >= staging && value <= staging + used ) {
+            cell[i] += delta;
+        }
+    }
+    char** slot = system->dictionary_index;
+    for( i = 0; i < system->dictionary_index_size; i++ ) {
+        if( slot[i] >= staging && slot[i] < staging + used ) {
+            slot[i] += delta;
+        }
+    }
+    char* indexed = system->dictionary_indexed;
+    if( indexed >= staging && indexed < staging + used ) {
+        system->dictionary_indexed = indexed + delta;
+    }
+    char* latest = system->latest;
+    if( latest >= staging && latest < staging + used ) {
+        system->latest = latest + delta;
+    }
+
+    uint32 sector;
+    for( sector = ( flash + ROM_SECTOR_SIZE - 1 ) / ROM_SECTOR_SIZE;
+         sector * ROM_SECTOR_SIZE < flash + used; sector++ ) {
+        if( spi_flash_erase_sector( sector ) != SPI_FLASH_RESULT_OK ) {
+            return -1;
+        }
+    }
+    if( spi_flash_write( flash, (uint32*) staging, used ) != SPI_FLASH_RESULT_OK ) {
+        return -1;
+    }
+    system->rom_dp = rom + used;
+    system->dp = staging;
+    system->peephole_at = 0;
+    memset( relocate, 0, ROM_RELOCATE_SIZE );
+    return 0;
+}
+
+int ICACHE_FLASH_ATTR forthright_rom_begin( system_t* system )
+{
+#ifdef FORTHRIGHT_DTC
+    // The flash is mapped at FLASH_MAP, where bit 30 is set, so NEXT and EXECUTE would take the
+    // words compiled into it for primitives and jump into their codewords.
+    return -1;
+#endif
+    if( system->rom_staging != NULL ) {
+        return -1;
+    }
+    char* staging = os_malloc( ROM_SECTOR_SIZE + ROM_RELOCATE_SIZE );
+    if( staging == NULL ) {
+        return -1;
+    }
+    memset( staging + ROM_SECTOR_SIZE, 0, ROM_RELOCATE_SIZE );
+    system->rom_ram_dp = system->dp;
+    system->rom_staging = staging;
+    system->segment_start = staging;
+    system->segment_end = staging + ROM_SECTOR_SIZE;
+    system->dp = staging;
+    system->peephole_at = 0;
+    return 0;
+}
+
+int ICACHE_FLASH_ATTR forthright_rom_end( system_t* system )
+{
+    char* staging = system->rom_staging;
+    if( staging == NULL ) {
+        return -1;
+    }
+    int result = rom_commit( system );
+    if( result < 0 ) {
+        while( (char*) system->latest >= staging && (char*) system->latest < staging + ROM_SECTOR_SIZE ) {
+            system->latest = *(char**) system->latest;
+        }
+        system->dictionary_indexed = 0;
+    }
+    os_free( staging );
+    system->rom_staging = NULL;
+    system->dp = system->rom_ram_dp;
+    system->peephole_at = 0;
+    forthright_find_segment( system );
+    return result;
+}
+
+int ICACHE_FLASH_ATTR forthright_make_room( system_t* system )
+{
+    if( system->rom_staging != NULL ) {
+        if( (char*) system->dp + DATA_SEGMENT_SLACK <= (char*) system->rom_staging + ROM_SECTOR_SIZE ) {
+            return 0;
+        }
+        return rom_commit( system );
+    }
+    forthright_find_segment( system );
+    char* dp = system->dp;
+    int inside = dp >= (char*) system->segment_start && dp < (char*) system->segment_end;
+    if( inside && dp + DATA_SEGMENT_SLACK <= (char*) system->segment_end ) {
+        return 0;
+    }
+    int size = system->segment_chunk & ~3;
+    if( size >= sizeof( segment_t ) + DATA_SEGMENT_SLACK
+        && system_get_free_heap_size() >= size + DATA_SEGMENT_HEAP_RESERVE ) {
+        segment_t* segment = os_malloc( size );
+        if( segment != NULL ) {
+            segment->previous = system->segments;
+            segment->end = (char*) segment + size;
+            system->segments = segment;
+            system->segment_start = segment + 1;
+            system->segment_end = segment->end;
+            system->dp = segment + 1;
+            return 0;
+        }
+    }
+    return inside ? 0 : -1;			// what is left will have to do
+}
+
+int ICACHE_FLASH_ATTR forthright_data_segment_size( system_t* system )
+{
+    int size = system->data_segment_size;
+    segment_t* segment;
+    forthright_find_segment( system );
+    for( segment = system->segments; segment != NULL; segment = segment->previous ) {
+        size += segment->end - (char*) segment;
+    }
+    return size;
+}
+
+/* Blocks start with a cell holding their size, a multiple of 16 which includes that cell, and
+   with the lowest bit set while in use. Blocks of up to HEAP_CLASS_MAX bytes come in powers of
+   two, and a freed one goes on the free list of its size class, for the next ALLOCATE of that
+   class to take in O(1). Larger ones go on one list, which is searched first fit, and split. The
+   free lists are linked through the cell after the size, and end with 0. Other blocks are carved
+   from the top, which FREE lowers again when it frees the block just below it.
+*/
+#define HEAP_CELL( offset ) ( *(int*) ( heap.base + ( offset ) ) )
+
+static int ICACHE_FLASH_ATTR heap_class( int size_of )
+{
+    return 28 - __builtin_clz( size_of - 1 );	// 16 is class 0
+}
+
+static int ICACHE_FLASH_ATTR heap_size_of( int size )
+{
+    int size_of = ( size + 4 + 15 ) & ~15;
+    return size_of <= HEAP_CLASS_MAX ? 16 << heap_class( size_of ) : size_of;
+}
+
+/* While there is an arena, blocks are taken one after the other from above the top, each after a
+   cell with its size, and only RELEASE-ARENA gives them back. */
+static int ICACHE_FLASH_ATTR in_arena( void* p )
+{
+    int offset = (char*) p - heap.base;
+    return heap.arena != 0 && offset >= heap.arena_base + 4 && offset < heap.arena;
+}
+
+static void* ICACHE_FLASH_ATTR arena_allocate( int size )
+{
+    int size_of = ( size + 4 + 3 ) & ~3;
+    if( size < 0 || size > heap.size || heap.arena + size_of > heap.size ) {
+        return NULL;
+    }
+    HEAP_CELL( heap.arena ) = size_of;
+    heap.arena += size_of;
+    return heap.base + heap.arena - size_of + 4;
+}
+
+static int ICACHE_FLASH_ATTR heap_block( void* p )
+{
+    int block = (char*) p - 4 - heap.base;
+    if( block < 0 || block >= heap.top || ( block & 15 ) != 0 || ( HEAP_CELL( block ) & 1 ) == 0 ) {
+        return -1;
+    }
+    return block;
+}
+
+/* Takes a block from the size classes or the top. While there is an arena, the top can only
+   grow up to where the arena starts. */
+static void* ICACHE_FLASH_ATTR heap_allocate( int size )
+{
+    if( size < 0 || size > heap.size ) {
+        return NULL;
+    }
+    int size_of = heap_size_of( size );
+    int block;
+    if( size_of <= HEAP_CLASS_MAX ) {
+        int class = heap_class( size_of );
+        block = heap.classes[class];
+        if( block != 0 ) {
+            heap.classes[class] = HEAP_CELL( block + 4 );
+            goto found;
+        }
+    } else {
+        int* link = &heap.large;
+        for( block = *link; block != 0; link = &HEAP_CELL( block + 4 ), block = *link ) {
+            int left = HEAP_CELL( block ) - size_of;
+            if( left >= 0 ) {
+                *link = HEAP_CELL( block + 4 );
+                if( left > HEAP_CLASS_MAX ) {
+                    HEAP_CELL( block + size_of ) = left;	// the rest stays free
+                    HEAP_CELL( block + size_of + 4 ) = heap.large;
+                    heap.large = block + size_of;
+                } else {
+                    size_of += left;
+                }
+                goto found;
+            }
+        }
+    }
+    if( heap.top + size_of > ( heap.arena != 0 ? heap.arena_base : heap.size ) ) {
+        return NULL;
+    }
+    block = heap.top;
+    heap.top += size_of;
+
+found:
+    HEAP_CELL( block ) = size_of | 1;
+    heap.used += size_of;
+    return heap.base + block + 4;
+}
+
+void* ICACHE_FLASH_ATTR forthright_allocate( system_t* system, int size )
+{
+    if( heap.arena != 0 ) {
+        return arena_allocate( size );
+    }
+    return heap_allocate( size );
+}
+
+int ICACHE_FLASH_ATTR forthright_free( system_t* system, void* p )
+{
+    if( in_arena( p ) ) {
+        return 0;				// until RELEASE-ARENA
+    }
+    int block = heap_block( p );
+    if( block < 0 ) {
+        return -1;
+    }
+    int size_of = HEAP_CELL( block ) & ~1;
+    HEAP_CELL( block ) = size_of;
+    heap.used -= size_of;
+    if( block + size_of == heap.top ) {
+        heap.top = block;
+    } else if( size_of <= HEAP_CLASS_MAX ) {
+        int class = heap_class( size_of );
+        HEAP_CELL( block + 4 ) = heap.classes[class];
+        heap.classes[class] = block;
+    } else {
+        HEAP_CELL( block + 4 ) = heap.large;
+        heap.large = block;
+    }
+    return 0;
+}
+
+void* ICACHE_FLASH_ATTR forthright_resize( system_t* system, void* p, int size )
+{
+    if( in_arena( p ) ) {
+        int block = (char*) p - 4 - heap.base;
+        int size_of = HEAP_CELL( block );
+        int wanted = ( size + 4 + 3 ) & ~3;
+        if( size < 0 || size + 4 <= size_of ) {
+            return size < 0 ? NULL : p;
+        }
+        if( block + size_of == heap.arena && block + wanted <= heap.size ) {
+            HEAP_CELL( block ) = wanted;		// the last block grows where it is
+            heap.arena = block + wanted;
+            return p;
+        }
+        void* moved = arena_allocate( size );
+        if( moved != NULL ) {
+            memcpy( moved, p, size_of - 4 );
+        }
+        return moved;
+    }
+    int block = heap_block( p );
+    if( block < 0 || size < 0 || size > heap.size ) {
+        return NULL;
+    }
+    int size_of = HEAP_CELL( block ) & ~1;
+    if( size + 4 <= size_of ) {
+        return p;
+    }
+    int wanted = heap_size_of( size );
+    if( block + size_of == heap.top && block + wanted <= ( heap.arena != 0 ? heap.arena_base : heap.size ) ) {
+        HEAP_CELL( block ) = wanted | 1;		// the top block grows where it is
+        heap.used += wanted - size_of;
+        heap.top = block + wanted;
+        return p;
+    }
+    void* moved = heap_allocate( size );		// not into the arena, which it would not outlive
+    if( moved != NULL ) {
+        memcpy( moved, p, size_of - 4 );
+        forthright_free( system, p );
+    }
+    return moved;
+}
+
+void ICACHE_FLASH_ATTR forthright_heap_stats( system_t* system, int* stats )
+{
+    int in_use = heap.arena != 0 ? heap.arena - heap.arena_base : 0;
+    int largest = heap.size - ( heap.arena != 0 ? heap.arena : heap.top );
+    int block;
+    int class;
+    for( class = 0; class < HEAP_CLASSES; class++ ) {
+        if( heap.classes[class] != 0 && ( 16 << class ) > largest ) {
+            largest = 16 << class;
+        }
+    }
+    for( block = heap.large; block != 0; block = HEAP_CELL( block + 4 ) ) {
+        if( HEAP_CELL( block ) > largest ) {
+            largest = HEAP_CELL( block );
+        }
+    }
+    stats[0] = heap.used + in_use;
+    stats[1] = heap.size > HEAP_FIRST ? heap.size - HEAP_FIRST - heap.used - in_use : 0;
+    stats[2] = largest > 4 ? largest - 4 : 0;
+}
+
+void* ICACHE_FLASH_ATTR forthright_mark_arena( system_t* system )
+{
+    if( heap.arena == 0 ) {
+        heap.arena_base = heap.arena = heap.top;
+    }
+    return heap.base + heap.arena;
+}
+
+int ICACHE_FLASH_ATTR forthright_release_arena( system_t* system, void* mark )
+{
+    int offset = (char*) mark - heap.base;
+    if( heap.arena == 0 || offset < heap.arena_base || offset > heap.arena ) {
+        return -1;
+    }
+    heap.arena = offset == heap.arena_base ? 0 : offset;
+    return 0;
+}
+
+/* The last of the built-in words, which the words in the data segment are defined on top of. With
+   the ROM image, that is the last word of forthright.f, so it tells one firmware from another. */
+static void* ICACHE_FLASH_ATTR builtin_latest( system_t* system )
+{
+    char* header = system->latest;
+    while( in_data_segment( system, header ) ) {
+        header = *(char**) header;
+    }
+    return header;
+}
+
+static int ICACHE_FLASH_ATTR open_image( const char* filename, int length, int flags )
+{
+    char name[FILENAME_SIZE + 1];
+    if( length > FILENAME_SIZE ) {
+        return -1;
+    }
+    memcpy( name, filename, length );
+    name[length] = 0;
+    return open( name, flags );
+}
+
+int ICACHE_FLASH_ATTR forthright_save_image( system_t* system, const char* filename, int length )
+{
+    forthright_find_segment( system );
+    if( system->segments != NULL || system->rom_staging != NULL ) {
+        return -1;				// only the data segment itself is saved
+    }
+    image_header_t header;
+    header.magic = IMAGE_MAGIC;
+    header.builtin = builtin_latest( system );
+    header.data_segment = system->data_segment;
+    header.used = (char*) system->dp - (char*) system->data_segment;
+    header.latest = system->latest;
+    header.base = system->base;
+
+    int fd = open_image( filename, length, O_WRONLY | O_CREAT | O_TRUNC );
+    if( fd < 0 ) {
+        return -1;
+    }
+    int ok = write( fd, &header, sizeof( header ) ) == sizeof( header )
+        && write( fd, system->data_segment, header.used ) == header.used;
+    close( fd );
+    return ok ? 0 : -1;
+}
+
+int ICACHE_FLASH_ATTR forthright_load_image( system_t* system, const char* filename, int length )
+{
+    image_header_t header;
+    if( system->rom_staging != NULL ) {
+        return -1;
+    }
+    int fd = open_image( filename, length, O_RDONLY );
+    if( fd < 0 ) {
+        return -1;
+    }
+    // The cells that hold addresses can't be told from numbers, so they can't be moved along if
+    // the data segment has been allocated somewhere else since. The image is refused instead.
+    if( read( fd, &header, sizeof( header ) ) != sizeof( header ) || header.magic != IMAGE_MAGIC
+        || header.builtin != builtin_latest( system ) || header.data_segment != system->data_segment
+        || header.used > system->data_segment_size ) {
+        close( fd );
+        return -1;
+    }
+    int ok = read( fd, system->data_segment, header.used ) == header.used;
+    close( fd );
+
+    system->dictionary_indexed = 0;			// The (FIND) index is stale either way,
+    system->peephole_at = 0;				// and so is the previous instruction.
+    if( !ok ) {
+        system->latest = header.builtin;
+        system->dp = system->data_segment;
+        forthright_find_segment( system );		// frees the chained segments
+        return -1;
+    }
+
+    system->latest = header.latest;
+    system->dp = system->data_segment + header.used;
+    system->base = header.base;
+    forthright_find_segment( system );
+    return 0;
+}
@@ -15,10 +15,37 @@ extern "C" {
 //   BASE            The current base for printing and reading numbers.
 
 #define MAX_WORD_SIZE 32
-#define DATA_SEGMENT_SIZE 8192
+#ifndef DATA_SEGMENT_SIZE
+#define DATA_SEGMENT_SIZE 0		// 0 takes half of the free heap above DATA_SEGMENT_HEAP_RESERVE
+#endif
+#ifndef DATA_SEGMENT_CHUNK
+#define DATA_SEGMENT_CHUNK 2048		// chained when the data segment is full, see segment-chunk
+#endif
+#define DATA_SEGMENT_SLACK 256		// header, chains a segment when less than this is left
+#define DATA_SEGMENT_HEAP_RESERVE 16384	// left for the SDK, WiFi and TCP
 #define DATA_STACK_SIZE 512
 #define RETURN_STACK_SIZE 512
-#define INPUT_BUFFER_SIZE 64
+#define STACK_GUARD 64			// bytes below each stack for overflows, until INTERPRET checks
+#define STACK_CANARY 0x57ac6ead		// in the cell below each stack, see STACK GUARDS in esp8266.S
+#ifndef INPUT_BUFFER_SIZE
+#define INPUT_BUFFER_SIZE 256		// the Forth input buffer, refilled from the input ring
+#endif
+#ifndef INPUT_RING_SIZE
+#define INPUT_RING_SIZE 1024		// filled by the input task while Forth parses, a power of 2
+#endif
+#define DICTIONARY_INDEX_SIZE 512	// slots in the hash index over the word names, a power of 2
+#ifndef ROM_SEGMENT_FLASH
+#define ROM_SEGMENT_FLASH 0x90000	// where ROM{ compiles to in flash, after irom0text, 1 MB flash or more
+#endif
+#ifndef ROM_SEGMENT_SECTORS
+#define ROM_SEGMENT_SECTORS 16
+#endif
+#define ROM_SECTOR_SIZE 4096		// staged in RAM and written a sector at a time
+#define ROM_RELOCATE_SIZE ( ROM_SECTOR_SIZE / 32 )	// after the buffer, a bit per cell, see ROM{
+#define FLASH_MAP 0x40200000		// where the flash is mapped, reading whole cells only
+#ifndef HEAP_SIZE
+#define HEAP_SIZE 8192			// for ALLOCATE, FREE and RESIZE, taken before the data segment
+#endif
 
 
 typedef struct
@@ -54,10 +81,90 @@ typedef struct
     int initializing;			// offset 80
     int echo;				// offset 84
 
+    void* peephole_at;			// offset 88
+    void* peephole_end;			// offset 92
+
+    void* dictionary_index;		// offset 96
+    int dictionary_index_size;		// offset 100
+    int dictionary_index_used;		// offset 104
+    void* dictionary_indexed;		// offset 108
+    void* find_key;			// offset 112
+
+    void* segment_start;		// offset 116, the segment that DP is in
+    void* segment_end;			// offset 120
+    void* segments;			// offset 124, the newest segment chained to the data segment
+    int segment_chunk;			// offset 128, bytes to chain when full, 0 never
+
+    void* rom_staging;			// offset 132, the sector DP is in after ROM{, or NULL
+    void* rom_dp;			// offset 136, the next free byte in the flash, mapped
+    void* rom_ram_dp;			// offset 140, DP to go back to at }ROM
+
 } system_t;
 
 void forthright();
 
+/* Writes the words compiled into the data segment, with LATEST, DP and BASE, to the SPIFFS file.
+   Returns 0, or -1 if the file can't be written or segments have been chained to the data segment.
+*/
+int forthright_save_image( system_t* system, const char* filename, int length );
+
+/* Reads the file written by forthright_save_image() into the data segment, and replaces the words
+   in it. Returns 0, or -1 if the file can't be read, was saved with the data segment somewhere else
+   or on top of other built-in words, i.e. by another firmware. If the file is cut short, the
+   data segment is left empty.
+*/
+int forthright_load_image( system_t* system, const char* filename, int length );
+
+/* Points segment_start and segment_end at the segment that DP is in, and frees the chained
+   segments above it, which FORGET leaves empty.
+*/
+void forthright_find_segment( system_t* system );
+
+/* Makes room for a definition at DP, by chaining a new segment of segment_chunk bytes to the data
+   segment when less than DATA_SEGMENT_SLACK bytes are left, or after ROM{ by writing the buffer to
+   the flash. Returns 0, or -1 if it is full.
+*/
+int forthright_make_room( system_t* system );
+
+/* The size of the data segment and all segments chained to it. */
+int forthright_data_segment_size( system_t* system );
+
+/* Points DP at a sector sized buffer, which forthright_make_room() writes to the flash when it is
+   full, with its cells relocated to where it ends up. Returns 0, or -1 if already compiling to
+   flash or there is no RAM for the buffer.
+*/
+int forthright_rom_begin( system_t* system );
+
+/* Writes what is left in the buffer to the flash and points DP back where it was at ROM{. Returns
+   0, or -1 if not compiling to flash or the flash is full, in which case the words in the buffer
+   are dropped.
+*/
+int forthright_rom_end( system_t* system );
+
+/* ALLOCATE, FREE and RESIZE, from the heap. forthright_allocate() and forthright_resize() return
+   a block of at least size bytes, or NULL if there is none. forthright_resize() leaves the block
+   at p as it is then, and otherwise frees it if the data had to be moved. Both forthright_free()
+   and forthright_resize() fail, with -1 and NULL, if p is not an allocated block.
+*/
+void* forthright_allocate( system_t* system, int size );
+
+int forthright_free( system_t* system, void* p );
+
+void* forthright_resize( system_t* system, void* p, int size );
+
+/* Fills in the bytes allocated, including the cell before each block, the bytes free, and the
+   largest block that can be allocated. The difference between the last two is fragmentation. */
+void forthright_heap_stats( system_t* system, int* stats );
+
+/* MARK-ARENA and RELEASE-ARENA. From the first forthright_mark_arena(), ALLOCATE and RESIZE take
+   blocks from the free heap above the top, one after the other, and FREE leaves them be. Each
+   returns a mark, and forthright_release_arena() gives back everything allocated since the mark
+   at once, and ends the arena at the first. Returns 0, or -1 if the mark is not in the arena.
+*/
+void* forthright_mark_arena( system_t* system );
+
+int forthright_release_arena( system_t* system, void* mark );
+
 int forthright_divide( int a, int b );
 
 int forthright_modulo( int a, int b );
@@ -95,6 +202,12 @@ void forthright_putChar( char ch );
  */
 void forthright_putChars( char* str, int length );
 
+/*
+ * Sends any buffered output on its way. Output to the TCP shell is otherwise sent when a
+ * packet is full, or when Forth waits for input; the serial port is drained by interrupt.
+ */
+void forthright_flush();
+
 /* This method will send the characters received to the
    secondary serial port, used for debugging Forthright itself.
 
@@ -7,7 +7,15 @@ extern "C" {
 #endif
 
 #ifndef MAX_PACKET_SIZE
-#define MAX_PACKET_SIZE 1500
+#define MAX_PACKET_SIZE 1460    // the TCP MSS, so that every full packet is one segment
+#endif
+
+#ifndef TCP_SHELL_TX_BUFFERS
+#define TCP_SHELL_TX_BUFFERS 4  // packets of output that may be in flight at once
+#endif
+
+#ifndef TCP_SHELL_RX_SIZE
+#define TCP_SHELL_RX_SIZE 4096  // the receive ring, a power of 2 holding at least two packets
 #endif
 
 void ICACHE_FLASH_ATTR tcp_shell_init();
@@ -18,6 +26,8 @@ void ICACHE_FLASH_ATTR tcp_shell_put_char(char ch);
 
 void ICACHE_FLASH_ATTR tcp_shell_put_chars(char* buffer, int bufsize);
 
+void ICACHE_FLASH_ATTR tcp_shell_flush();
+
 int ICACHE_FLASH_ATTR tcp_shell_read_chars( char* buffer, int bufsize );
 
 #ifdef __cplusplus
@@ -34,6 +34,18 @@ extern "C" {
 #define UART_INTR_MASK          0x1ff
 #define UART_LINE_INV_MASK      (0x3f<<19)
 
+#ifndef UART_BAUD_RATE
+#define UART_BAUD_RATE          BIT_RATE_115200
+#endif
+
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE       2048    // filled by the RX interrupt, a power of 2
+#endif
+
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE       1024    // Forth output to UART0, a power of 2
+#endif
+
 typedef enum {
     UART_WordLength_5b = 0x0,
     UART_WordLength_6b = 0x1,
@@ -281,6 +293,9 @@ void uart_init_new(void);
 
 int uart_read_chars( char* buffer, int bufsize );
 
+/* Queues the characters for UART0, with '\n' sent as "\r\n". Waits only while the tx ring is full. */
+int uart_write_chars( char* buffer, int length );
+
 /**
   * @}
   */
@@ -15,69 +15,6 @@ static xTaskHandle indoorio_task_fs;
 
 static void report_error(char *check, s32_t errors);
 
-#define FLASH_UNIT_SIZE 4
-
-static s32_t ICACHE_FLASH_ATTR hal_readwrite(u32_t addr, u32_t size, u8_t *p, int write) {
-    /*
-     * With proper configurarion fs never reads or writes more than
-     * LOG_PAGE_SIZE
-     */
-
-    if (size > fs.cfg.log_page_size) {
-        printf("Invalid size provided to read/write (%d)\n\r", (int) size);
-        return SPIFFS_ERR_NOT_CONFIGURED;
-    }
-
-    char tmp_buf[fs.cfg.log_page_size + FLASH_UNIT_SIZE * 2];
-    u32_t aligned_addr = addr & (-FLASH_UNIT_SIZE);
-    u32_t aligned_size = ((size + (FLASH_UNIT_SIZE - 1)) & -FLASH_UNIT_SIZE) + FLASH_UNIT_SIZE;
-
-    int res = spi_flash_read(aligned_addr, (u32_t *) tmp_buf, aligned_size);
-
-    if (res != 0) {
-        printf("...spi_flash_read failed: %d (%d, %d)\n\r", res, (int) aligned_addr,
-               (int) aligned_size);
-        return res;
-    }
-
-    if (!write) {
-        memcpy(p, tmp_buf + (addr - aligned_addr), size);
-        return SPIFFS_OK;
-    }
-
-    memcpy(tmp_buf + (addr - aligned_addr), p, size);
-
-    res = spi_flash_write(aligned_addr, (u32_t *) tmp_buf, aligned_size);
-
-    if (res != 0) {
-        return res;
-    }
-
-    return SPIFFS_OK;
-}
-
-static s32_t ICACHE_FLASH_ATTR hal_read(u32_t addr, u32_t size, u8_t *dst) {
-    return hal_readwrite(addr, size, dst, 0);
-}
-
-static s32_t ICACHE_FLASH_ATTR hal_write(u32_t addr, u32_t size, u8_t *src) {
-    return hal_readwrite(addr, size, src, 1);
-}
-
-static s32_t ICACHE_FLASH_ATTR hal_erase(u32_t addr, u32_t size) {
-    /*
-     * With proper configurarion fs always
-     * provides here sector address & sector size
-     */
-    if (size != fs.cfg.phys_erase_block || addr % fs.cfg.phys_erase_block != 0) {
-        printf("Invalid size provided to esp_spiffs_erase (%d, %d)\n\r",
-               (int) addr, (int) size);
-        return SPIFFS_ERR_NOT_CONFIGURED;
-    }
-
-    return spi_flash_erase_sector(addr / fs.cfg.phys_erase_block);
-}
-
 LOCAL s32_t ICACHE_FLASH_ATTR fs_init(struct esp_spiffs_config *config) {
     if (SPIFFS_mounted(&fs)) {
         return -1;
@@ -92,9 +29,9 @@ LOCAL s32_t ICACHE_FLASH_ATTR fs_init(struct esp_spiffs_config *config) {
     cfg.log_block_size = config->log_block_size;
     cfg.log_page_size = config->log_page_size;
 
-    cfg.hal_read_f = hal_read;
-    cfg.hal_write_f = hal_write;
-    cfg.hal_erase_f = hal_erase;
+    cfg.hal_read_f = fs_hal_read;
+    cfg.hal_write_f = fs_hal_write;
+    cfg.hal_erase_f = fs_hal_erase;
 
     if (spiffs_work_buf != NULL) {
         free(spiffs_work_buf);
@@ -11,4 +11,9 @@
 
 bool indoorio_fs_init();
 
+/* The flash access for SPIFFS, see fs_hal.c. Needs spiffs.h first. */
+s32_t fs_hal_read(u32_t addr, u32_t size, u8_t *dst);
+s32_t fs_hal_write(u32_t addr, u32_t size, u8_t *src);
+s32_t fs_hal_erase(u32_t addr, u32_t size);
+
 #endif
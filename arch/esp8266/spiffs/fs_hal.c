@@ -0,0 +1,145 @@
+#include <esp_common.h>
+#include <spiffs/spiffs.h>
+#include "fs.h"
+
+/*
+ * SPIFFS' hal_read_f, hal_write_f and hal_erase_f, on the SDK's spi_flash_* calls, which only
+ * take whole 4 byte words, from and to word aligned buffers. Kept apart from fs.c so that the
+ * host build can run them against the RAM flash in arch/host/test/fake_flash.c, see
+ * spiffs_bench there.
+ *
+ * fs.c checked the sizes against fs.cfg, which these can't see, so they check them against
+ * LOG_PAGE_SIZE and SPI_FLASH_SEC_SIZE from fs.h instead, the values fs_task() configures.
+ * A file system set up with another page or erase block size is refused here.
+ */
+
+#define FLASH_UNIT_SIZE 4
+
+static s32_t ICACHE_FLASH_ATTR check_size(u32_t size) {
+    /*
+     * With proper configurarion fs never reads or writes more than
+     * LOG_PAGE_SIZE
+     */
+    if (size > LOG_PAGE_SIZE) {
+        printf("Invalid size provided to read/write (%d)\n\r", (int) size);
+        return SPIFFS_ERR_NOT_CONFIGURED;
+    }
+    return SPIFFS_OK;
+}
+
+#define IS_ALIGNED(x) (((size_t) (x) & (FLASH_UNIT_SIZE - 1)) == 0)
+
+s32_t ICACHE_FLASH_ATTR fs_hal_read(u32_t addr, u32_t size, u8_t *dst) {
+    s32_t res = check_size(size);
+    if (res != SPIFFS_OK) {
+        return res;
+    }
+
+    if (IS_ALIGNED(addr) && IS_ALIGNED(size) && IS_ALIGNED(dst)) {
+        return spi_flash_read(addr, (u32_t *) dst, size);
+    }
+
+    /* The words around it, then the bytes asked for out of them. */
+    u32_t tmp_buf[LOG_PAGE_SIZE / FLASH_UNIT_SIZE + 2];
+    u32_t aligned_addr = addr & (-FLASH_UNIT_SIZE);
+    u32_t aligned_size = ((addr + size + (FLASH_UNIT_SIZE - 1)) & -FLASH_UNIT_SIZE) - aligned_addr;
+
+    res = spi_flash_read(aligned_addr, tmp_buf, aligned_size);
+
+    if (res != 0) {
+        printf("...spi_flash_read failed: %d (%d, %d)\n\r", res, (int) aligned_addr,
+               (int) aligned_size);
+        return res;
+    }
+
+    memcpy(dst, (u8_t *) tmp_buf + (addr - aligned_addr), size);
+    return SPIFFS_OK;
+}
+
+/*
+ * Programming the flash can only clear bits, so the bytes of a word that
+ * are not to be written are written as 0xFF, which leaves them as they are.
+ * There is no need to read them first.
+ */
+static int ICACHE_FLASH_ATTR is_erased(u8_t *word) {
+    return (word[0] & word[1] & word[2] & word[3]) == 0xFF;
+}
+
+static s32_t ICACHE_FLASH_ATTR write_part_word(u32_t addr, u32_t size, u8_t *src) {
+    u32_t word = 0xFFFFFFFF;
+    memcpy((u8_t *) &word + (addr & (FLASH_UNIT_SIZE - 1)), src, size);
+    return spi_flash_write(addr & (-FLASH_UNIT_SIZE), &word, FLASH_UNIT_SIZE);
+}
+
+s32_t ICACHE_FLASH_ATTR fs_hal_write(u32_t addr, u32_t size, u8_t *src) {
+    s32_t res = check_size(size);
+    if (res != SPIFFS_OK) {
+        return res;
+    }
+
+    /* The bytes before the first whole word. */
+    u32_t head = (FLASH_UNIT_SIZE - (addr & (FLASH_UNIT_SIZE - 1))) & (FLASH_UNIT_SIZE - 1);
+    if (head > size) {
+        head = size;
+    }
+    if (head != 0) {
+        res = write_part_word(addr, head, src);
+        if (res != 0) {
+            return res;
+        }
+        addr += head;
+        src += head;
+        size -= head;
+    }
+
+    /* The whole words, from where they are if the SDK can take them from there. Erased words
+       at either end are left out, as writing them changes nothing. */
+    u32_t words = size & (-FLASH_UNIT_SIZE);
+    u32_t first = 0;
+    u32_t last = words;
+    while (first < last && is_erased(src + first)) {
+        first += FLASH_UNIT_SIZE;
+    }
+    while (last > first && is_erased(src + last - FLASH_UNIT_SIZE)) {
+        last -= FLASH_UNIT_SIZE;
+    }
+    if (first < last) {
+        if (IS_ALIGNED(src + first)) {
+            res = spi_flash_write(addr + first, (u32_t *) (src + first), last - first);
+        } else {
+            u32_t tmp_buf[LOG_PAGE_SIZE / FLASH_UNIT_SIZE];
+            memcpy(tmp_buf, src + first, last - first);
+            res = spi_flash_write(addr + first, tmp_buf, last - first);
+        }
+        if (res != 0) {
+            return res;
+        }
+    }
+    addr += words;
+    src += words;
+    size -= words;
+
+    /* The bytes after the last whole word. */
+    if (size != 0) {
+        res = write_part_word(addr, size, src);
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    return SPIFFS_OK;
+}
+
+s32_t ICACHE_FLASH_ATTR fs_hal_erase(u32_t addr, u32_t size) {
+    /*
+     * With proper configurarion fs always
+     * provides here sector address & sector size
+     */
+    if (size != SPI_FLASH_SEC_SIZE || addr % SPI_FLASH_SEC_SIZE != 0) {
+        printf("Invalid size provided to esp_spiffs_erase (%d, %d)\n\r",
+               (int) addr, (int) size);
+        return SPIFFS_ERR_NOT_CONFIGURED;
+    }
+
+    return spi_flash_erase_sector(addr / SPI_FLASH_SEC_SIZE);
+}
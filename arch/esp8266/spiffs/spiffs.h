@@ -169,6 +169,15 @@ typedef struct {
 #endif
 } spiffs_config;
 
+#if SPIFFS_IX_CACHE_ENTRIES
+/* where an object index page was last found */
+typedef struct {
+  spiffs_obj_id obj_id;
+  spiffs_span_ix spix;
+  spiffs_page_ix pix;
+} spiffs_ix_cache_entry;
+#endif
+
 typedef struct {
   // file system configuration
   spiffs_config cfg;
@@ -211,6 +220,18 @@ typedef struct {
   u32_t stats_gc_runs;
 #endif
 
+#if SPIFFS_FREE_MAP_BYTES
+  // a bit per object lookup entry, set if its page is free, see spiffs_obj_lu_find_free
+  u8_t free_map[SPIFFS_FREE_MAP_BYTES];
+  // set if the free map covers all blocks
+  u8_t free_map_valid;
+#endif
+
+#if SPIFFS_IX_CACHE_ENTRIES
+  // object index pages by object id and span index, see spiffs_obj_lu_find_id_and_span
+  spiffs_ix_cache_entry ix_cache[SPIFFS_IX_CACHE_ENTRIES];
+#endif
+
 #if SPIFFS_CACHE
   // cache memory
   void *cache;
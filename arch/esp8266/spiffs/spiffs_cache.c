@@ -144,10 +144,12 @@ s32_t spiffs_phys_rd(
 #endif
         res = spiffs_cache_page_remove_oldest(fs, SPIFFS_CACHE_FLAG_TYPE_WR, 0);
         cp = spiffs_cache_page_allocate(fs);
-        if (cp) {
-            cp->flags = SPIFFS_CACHE_FLAG_WRTHRU;
-            cp->pix = SPIFFS_PADDR_TO_PAGE(fs, addr);
+        if (cp == 0) {
+            // all cache pages are write cache pages
+            return fs->cfg.hal_read_f(addr, len, dst);
         }
+        cp->flags = SPIFFS_CACHE_FLAG_WRTHRU;
+        cp->pix = SPIFFS_PADDR_TO_PAGE(fs, addr);
 
         s32_t res2 = fs->cfg.hal_read_f(
                 addr - SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr),
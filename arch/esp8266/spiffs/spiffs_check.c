@@ -131,6 +131,7 @@ static s32_t spiffs_rewrite_index(spiffs *fs, spiffs_obj_id obj_id, spiffs_span_
       sizeof(spiffs_obj_id),
       (u8_t *)&obj_id);
   SPIFFS_CHECK_RES(res);
+  spiffs_obj_lu_taken(fs, free_pix);
   res = spiffs_page_delete(fs, objix_pix);
 
   return res;
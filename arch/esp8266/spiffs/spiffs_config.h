@@ -79,6 +79,21 @@ typedef int8_t  s8_t;
 #define SPIFFS_PAGE_CHECK               1
 #endif
 
+// Number of entries in the RAM index of where object index pages were last
+// found, so that reading and seeking in big files need not search the object
+// lookup pages of every block. Each entry takes 6 bytes. Set to 0 to disable.
+#ifndef SPIFFS_IX_CACHE_ENTRIES
+#define SPIFFS_IX_CACHE_ENTRIES         32
+#endif
+
+// Size in bytes of the RAM map of which pages are free, a bit per page, so
+// that allocating a page need not search the object lookup pages. 1024 bytes
+// map 8192 pages, 3 MB in 4 KB blocks of 512 byte pages. A file system with
+// more pages is searched as before. Set to 0 to disable.
+#ifndef SPIFFS_FREE_MAP_BYTES
+#define SPIFFS_FREE_MAP_BYTES           1024
+#endif
+
 // Define maximum number of gc runs to perform to reach desired free pages.
 #ifndef SPIFFS_GC_MAX_RUNS
 #define SPIFFS_GC_MAX_RUNS              5
@@ -220,6 +220,70 @@ int32_t spiffs_obj_lu_find_entry_visitor(
     return SPIFFS_VIS_END;
 }
 
+#if SPIFFS_FREE_MAP_BYTES
+// Bit in the free map for an object lookup entry
+#define SPIFFS_FREE_MAP_BIT(fs, bix, entry) ((u32_t) (bix) * SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs) + (entry))
+
+static void spiffs_free_map_set(
+        spiffs *fs,
+        u32_t bit,
+        int free) {
+    if (free) {
+        fs->free_map[bit >> 3] |= 1 << (bit & 7);
+    } else {
+        fs->free_map[bit >> 3] &= ~(1 << (bit & 7));
+    }
+}
+
+// Find the next free object lookup entry in the free map, from the same place
+// and with the same initial wrap as spiffs_obj_lu_find_entry_visitor would.
+// Each entry found is checked in the object lookup page, so a bit left set by
+// mistake only costs a read.
+static int32_t spiffs_free_map_find(
+        spiffs *fs,
+        spiffs_block_ix starting_block,
+        int starting_lu_entry,
+        spiffs_block_ix *block_ix,
+        int *lu_entry) {
+    int32_t res;
+    u32_t entries = fs->block_count * SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs);
+    u32_t bit = SPIFFS_FREE_MAP_BIT(fs, starting_block, starting_lu_entry);
+    u32_t left = entries;
+
+    if (starting_lu_entry >= (int) SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs) - 1) {
+        bit = SPIFFS_FREE_MAP_BIT(fs, starting_block + 1, 0);
+    }
+    while (left > 0) {
+        if (bit >= entries) {
+            bit = 0;
+        }
+        if ((bit & 7) == 0 && bit + 8 <= entries && left >= 8 && fs->free_map[bit >> 3] == 0) {
+            bit += 8;
+            left -= 8;
+            continue;
+        }
+        if (fs->free_map[bit >> 3] & (1 << (bit & 7))) {
+            spiffs_block_ix bix = bit / SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs);
+            int entry = bit % SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs);
+            spiffs_obj_id obj_id;
+            res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU | SPIFFS_OP_C_READ,
+                             0, SPIFFS_BLOCK_TO_PADDR(fs, bix) + entry * sizeof(spiffs_obj_id),
+                             sizeof(spiffs_obj_id), (uint8_t *) &obj_id);
+            SPIFFS_CHECK_RES(res);
+            if (obj_id == SPIFFS_OBJ_ID_FREE) {
+                *block_ix = bix;
+                *lu_entry = entry;
+                return SPIFFS_OK;
+            }
+            spiffs_free_map_set(fs, bit, 0);
+        }
+        bit++;
+        left--;
+    }
+    return SPIFFS_ERR_NOT_FOUND;
+}
+#endif
+
 int32_t spiffs_erase_block(
         spiffs *fs,
         spiffs_block_ix bix) {
@@ -236,6 +300,15 @@ int32_t spiffs_erase_block(
     }
     fs->free_blocks++;
 
+#if SPIFFS_FREE_MAP_BYTES
+    if (fs->free_map_valid) {
+        int entry;
+        for (entry = 0; entry < (int) SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs); entry++) {
+            spiffs_free_map_set(fs, SPIFFS_FREE_MAP_BIT(fs, bix, entry), 1);
+        }
+    }
+#endif
+
     // register erase count for this block
     res = _spiffs_wr(fs, SPIFFS_OP_C_WRTHRU | SPIFFS_OP_T_OBJ_LU2, 0,
                      SPIFFS_ERASE_COUNT_PADDR(fs, bix),
@@ -271,6 +344,11 @@ static int32_t spiffs_obj_lu_scan_v(
     (void) user_data;
     (void) user_p;
     if (obj_id == SPIFFS_OBJ_ID_FREE) {
+#if SPIFFS_FREE_MAP_BYTES
+        if (fs->free_map_valid) {
+            spiffs_free_map_set(fs, SPIFFS_FREE_MAP_BIT(fs, bix, ix_entry), 1);
+        }
+#endif
         if (ix_entry == 0) {
             fs->free_blocks++;
             // todo optimize further, return SPIFFS_NEXT_BLOCK
@@ -361,6 +439,11 @@ int32_t spiffs_obj_lu_scan(
     fs->free_blocks = 0;
     fs->stats_p_allocated = 0;
     fs->stats_p_deleted = 0;
+#if SPIFFS_FREE_MAP_BYTES
+    // the free map is filled by spiffs_obj_lu_scan_v, if the file system fits
+    memset(fs->free_map, 0, sizeof(fs->free_map));
+    fs->free_map_valid = fs->block_count * SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs) <= sizeof(fs->free_map) * 8;
+#endif
 
     res = spiffs_obj_lu_find_entry_visitor(fs,
                                            0,
@@ -401,8 +484,17 @@ int32_t spiffs_obj_lu_find_free(
             return SPIFFS_ERR_FULL;
         }
     }
+#if SPIFFS_FREE_MAP_BYTES
+    if (fs->free_map_valid) {
+        res = spiffs_free_map_find(fs, starting_block, starting_lu_entry, block_ix, lu_entry);
+    } else {
+        res = spiffs_obj_lu_find_id(fs, starting_block, starting_lu_entry,
+                                    SPIFFS_OBJ_ID_FREE, block_ix, lu_entry);
+    }
+#else
     res = spiffs_obj_lu_find_id(fs, starting_block, starting_lu_entry,
                                 SPIFFS_OBJ_ID_FREE, block_ix, lu_entry);
+#endif
     if (res == SPIFFS_OK) {
         fs->free_cursor_block_ix = *block_ix;
         fs->free_cursor_obj_lu_entry = *lu_entry;
@@ -417,6 +509,23 @@ int32_t spiffs_obj_lu_find_free(
     return res == SPIFFS_VIS_END ? SPIFFS_ERR_FULL : res;
 }
 
+// The caller of spiffs_obj_lu_find_free has written the object lookup entry of
+// pix, so it is no longer free. Until then its bit stays set in the free map,
+// so that an entry whose write failed is found again.
+void spiffs_obj_lu_taken(
+        spiffs *fs,
+        spiffs_page_ix pix) {
+#if SPIFFS_FREE_MAP_BYTES
+    if (fs->free_map_valid) {
+        spiffs_free_map_set(fs, SPIFFS_FREE_MAP_BIT(fs, SPIFFS_BLOCK_FOR_PAGE(fs, pix),
+                                                    SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, pix)), 0);
+    }
+#else
+    (void) fs;
+    (void) pix;
+#endif
+}
+
 // Find object lookup entry containing given id
 // Iterate over object lookup pages in each block until a given object id entry is found
 int32_t spiffs_obj_lu_find_id(
@@ -459,8 +568,18 @@ static int32_t spiffs_obj_lu_find_id_and_span_v(
     }
 }
 
+#if SPIFFS_IX_CACHE_ENTRIES
+static spiffs_ix_cache_entry *spiffs_ix_cache_slot(
+        spiffs *fs,
+        spiffs_obj_id obj_id,
+        spiffs_span_ix spix) {
+    return &fs->ix_cache[((u32_t) obj_id * 31 + spix) % SPIFFS_IX_CACHE_ENTRIES];
+}
+#endif
+
 // Find object lookup entry containing given id and span index
 // Iterate over object lookup pages in each block until a given object id entry is found
+// Object index pages are first looked for where the index cache last saw them
 int32_t spiffs_obj_lu_find_id_and_span(
         spiffs *fs,
         spiffs_obj_id obj_id,
@@ -471,6 +590,27 @@ int32_t spiffs_obj_lu_find_id_and_span(
     spiffs_block_ix bix;
     int entry;
 
+#if SPIFFS_IX_CACHE_ENTRIES
+    spiffs_ix_cache_entry *cached = 0;
+    if (obj_id & SPIFFS_OBJ_ID_IX_FLAG) {
+        cached = spiffs_ix_cache_slot(fs, obj_id, spix);
+        if (cached->obj_id == obj_id && cached->spix == spix) {
+            // the page may have moved since, so check it the way the search would
+            bix = SPIFFS_BLOCK_FOR_PAGE(fs, cached->pix);
+            entry = SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, cached->pix);
+            res = spiffs_obj_lu_find_id_and_span_v(fs, obj_id, bix, entry, (u32_t) spix,
+                                                   exclusion_pix ? &exclusion_pix : 0);
+            if (res != SPIFFS_VIS_COUNTINUE) {
+                SPIFFS_CHECK_RES(res);
+                if (pix) {
+                    *pix = cached->pix;
+                }
+                return res;
+            }
+        }
+    }
+#endif
+
     res = spiffs_obj_lu_find_entry_visitor(fs,
                                            fs->cursor_block_ix,
                                            fs->cursor_obj_lu_entry,
@@ -492,6 +632,14 @@ int32_t spiffs_obj_lu_find_id_and_span(
         *pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry);
     }
 
+#if SPIFFS_IX_CACHE_ENTRIES
+    if (cached) {
+        cached->obj_id = obj_id;
+        cached->spix = spix;
+        cached->pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry);
+    }
+#endif
+
     fs->cursor_block_ix = bix;
     fs->cursor_obj_lu_entry = entry;
 
@@ -562,6 +710,7 @@ int32_t spiffs_page_allocate_data(
                      0, SPIFFS_BLOCK_TO_PADDR(fs, bix) + entry * sizeof(spiffs_obj_id), sizeof(spiffs_obj_id),
                      (uint8_t *) &obj_id);
     SPIFFS_CHECK_RES(res);
+    spiffs_obj_lu_taken(fs, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry));
 
     fs->stats_p_allocated++;
 
@@ -644,6 +793,7 @@ int32_t spiffs_page_move(
                      sizeof(spiffs_obj_id),
                      (uint8_t *) &obj_id);
     SPIFFS_CHECK_RES(res);
+    spiffs_obj_lu_taken(fs, free_pix);
 
     fs->stats_p_allocated++;
 
@@ -720,6 +870,7 @@ int32_t spiffs_object_create(
                      0, SPIFFS_BLOCK_TO_PADDR(fs, bix) + entry * sizeof(spiffs_obj_id), sizeof(spiffs_obj_id),
                      (uint8_t *) &obj_id);
     SPIFFS_CHECK_RES(res);
+    spiffs_obj_lu_taken(fs, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry));
 
     fs->stats_p_allocated++;
 
@@ -814,6 +965,17 @@ void spiffs_cb_object_event(
         spiffs_page_ix new_pix,
         u32_t new_size) {
     (void) fd;
+#if SPIFFS_IX_CACHE_ENTRIES
+    // update the index cache
+    spiffs_ix_cache_entry *cached = spiffs_ix_cache_slot(fs, obj_id | SPIFFS_OBJ_ID_IX_FLAG, spix);
+    if (ev == SPIFFS_EV_IX_NEW || ev == SPIFFS_EV_IX_UPD) {
+        cached->obj_id = obj_id | SPIFFS_OBJ_ID_IX_FLAG;
+        cached->spix = spix;
+        cached->pix = new_pix;
+    } else if (cached->obj_id == (obj_id | SPIFFS_OBJ_ID_IX_FLAG) && cached->spix == spix) {
+        cached->obj_id = SPIFFS_OBJ_ID_DELETED;
+    }
+#endif
     // update index caches in all file descriptors
     obj_id &= ~SPIFFS_OBJ_ID_IX_FLAG;
     u32_t i;
@@ -527,6 +527,10 @@ s32_t spiffs_obj_lu_find_free(
     spiffs_block_ix *block_ix,
     int *lu_entry);
 
+void spiffs_obj_lu_taken(
+    spiffs *fs,
+    spiffs_page_ix pix);
+
 s32_t spiffs_obj_lu_find_id(
     spiffs *fs,
     spiffs_block_ix starting_block,
@@ -27,7 +27,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 
 LOCAL uint16_t shell_timeout = 3600; // 1 hour timeout
 
@@ -35,9 +34,27 @@ LOCAL struct espconn masterconn;
 LOCAL struct espconn *pespconn;
 
 LOCAL int is_connected = 0;
-LOCAL xQueueHandle tcp_shell_stdin;
-LOCAL char *stdout_buffer;
-LOCAL int stdout_pointer;
+
+/* Received segments are copied whole into the stdin ring, and read out in blocks. The indices
+   run freely; only received() moves stdin_head and only tcp_shell_read_chars moves stdin_tail.
+   When less than a packet fits, reception is held until the reader has caught up. */
+LOCAL char *stdin_ring;
+LOCAL volatile unsigned int stdin_head;
+LOCAL volatile unsigned int stdin_tail;
+LOCAL volatile int stdin_held;
+
+/* Output is collected into one of TCP_SHELL_TX_BUFFERS packets, which is handed to espconn when
+   it is full or on tcp_shell_flush(). espconn owns a packet until its sent callback, so the
+   writer only waits when all of them are in flight. The counts run freely; only
+   tcp_shell_flush moves tx_queued and only sent() and disconnected() move tx_done. */
+LOCAL char *tx_buffers;
+LOCAL int tx_pointer;                   // bytes in the packet being filled
+LOCAL volatile unsigned int tx_queued;
+LOCAL volatile unsigned int tx_done;
+
+/* Tracing of all traffic to the debug port, which costs a printf per character sent. */
+#ifdef TCP_SHELL_TRACE
+#define trace printf
 
 LOCAL void ICACHE_FLASH_ATTR debugstr( const char* fmt, char* buffer, int bufsize ) {
     char tmp[bufsize+1];
@@ -45,58 +62,111 @@ LOCAL void ICACHE_FLASH_ATTR debugstr( const char* fmt, char* buffer, int bufsiz
     tmp[bufsize] = 0;
     printf(fmt, tmp);
 }
+#else
+#define trace(...)
+#define debugstr(...)
+#endif
 
 int ICACHE_FLASH_ATTR tcp_shell_is_connected() {
     return is_connected;
 }
 
 int ICACHE_FLASH_ATTR tcp_shell_read_chars( char* buffer, int bufsize ) {
-
-    char ch;
-    int count = 0;
-    while( xQueueReceive( tcp_shell_stdin, &ch, 10 ) == pdTRUE ) {
-        buffer[count++] = ch;
+    unsigned int tail = stdin_tail;
+    unsigned int offset = tail % TCP_SHELL_RX_SIZE;
+    int count = stdin_head - tail;
+    int first;
+    if( count > bufsize ) {
+        count = bufsize;
+    }
+    first = TCP_SHELL_RX_SIZE - offset;
+    if( first > count ) {
+        first = count;
     }
+    memcpy( buffer, stdin_ring + offset, first );
+    memcpy( buffer + first, stdin_ring, count - first );
+    stdin_tail = tail + count;
     if( count > 0 ){
         debugstr("[Shell] read %s\n", buffer, count);
     }
+    if( stdin_held && TCP_SHELL_RX_SIZE - ( stdin_head - stdin_tail ) >= MAX_PACKET_SIZE ) {
+        stdin_held = 0;
+        espconn_recv_unhold( pespconn );
+    }
     if( pespconn->state == ESPCONN_CLOSE ) {
         is_connected = false;
     }
     return count;
 }
 
-void ICACHE_FLASH_ATTR tcp_shell_put_char(char ch) {
-    printf("[Shell] send %c\n", ch);
-    stdout_buffer[stdout_pointer++] = ch;
-    if( stdout_pointer > MAX_PACKET_SIZE || ch == '\n' ) {
-        espconn_send(pespconn, stdout_buffer, stdout_pointer);
-        stdout_pointer = 0;
+/* The packet being filled, once one is free. */
+LOCAL char * ICACHE_FLASH_ATTR tx_packet() {
+    while( tx_queued - tx_done >= TCP_SHELL_TX_BUFFERS && is_connected ) {
+        vTaskDelay( 1 );                // all packets in flight
     }
+    return tx_buffers + ( tx_queued % TCP_SHELL_TX_BUFFERS ) * MAX_PACKET_SIZE;
+}
+
+void ICACHE_FLASH_ATTR tcp_shell_put_char(char ch) {
+    trace("[Shell] send %c\n", ch);
+    tcp_shell_put_chars( &ch, 1 );
 }
 
 void ICACHE_FLASH_ATTR tcp_shell_put_chars(char* buffer, int bufsize) {
-    int i;
     debugstr("[Shell] send %s\n", buffer, bufsize);
-    for( i=0; i < bufsize; i++ ) {
-        tcp_shell_put_char(buffer[i]);
+    while( bufsize > 0 ) {
+        char *packet = tx_packet();
+        int count = MAX_PACKET_SIZE - tx_pointer;
+        if( count > bufsize ) {
+            count = bufsize;
+        }
+        memcpy( packet + tx_pointer, buffer, count );
+        tx_pointer += count;
+        buffer += count;
+        bufsize -= count;
+        if( tx_pointer == MAX_PACKET_SIZE ) {
+            tcp_shell_flush();
+        }
+    }
+}
+
+void ICACHE_FLASH_ATTR tcp_shell_flush() {
+    if( tx_pointer > 0 ) {
+        char *packet = tx_packet();
+        tx_queued++;                    // before sending, as sent() may come at once
+        while( espconn_send( pespconn, (uint8 *) packet, tx_pointer ) != ESPCONN_OK && is_connected ) {
+            vTaskDelay( 1 );            // espconn is out of send buffers
+        }
+        tx_pointer = 0;
     }
 }
 
 LOCAL void ICACHE_FLASH_ATTR disconnected(void *arg) {
     pespconn = (struct espconn *) arg;
     is_connected = FALSE;
-    printf("[Shell] disconnected\n");
+    tx_done = tx_queued;        // nothing more will be sent
+    trace("[Shell] disconnected\n");
 }
 
 LOCAL void send_to_stdin(char* data, int length){
-    int i;
+    unsigned int head = stdin_head;
+    unsigned int offset = head % TCP_SHELL_RX_SIZE;
+    int space = TCP_SHELL_RX_SIZE - ( head - stdin_tail );
+    int first;
     debugstr("[Shell] to stdin: %s\n", data, length);
-    for( i=0; i < length; i++ ) {
-        if( xQueueSend( tcp_shell_stdin, (void *) &data[i], ( portTickType ) 10 ) != pdPASS ) {
-            // Failed to post the message, even after timeout
-            // what to do?
-        }
+    if( length > space ) {
+        length = space;         // can only happen if the peer ignores the hold
+    }
+    first = TCP_SHELL_RX_SIZE - offset;
+    if( first > length ) {
+        first = length;
+    }
+    memcpy( stdin_ring + offset, data, first );
+    memcpy( stdin_ring, data + first, length - first );
+    stdin_head = head + length;
+    if( !stdin_held && space - length < MAX_PACKET_SIZE ) {
+        stdin_held = 1;
+        espconn_recv_hold( pespconn );
     }
 }
 
@@ -107,31 +177,35 @@ LOCAL void ICACHE_FLASH_ATTR received(void *arg, char *pusrdata, unsigned short
 }
 
 LOCAL void ICACHE_FLASH_ATTR sent( void* arg ){
-    printf("[Shell] data sent\n");
+    if( tx_done != tx_queued ) {
+        tx_done++;              // the oldest packet is free again
+    }
+    trace("[Shell] data sent\n");
 }
 
 LOCAL void ICACHE_FLASH_ATTR write_finished(void *arg) {
-    printf("[Shell] write finished\n");
+    trace("[Shell] write finished\n");
 }
 
 LOCAL void ICACHE_FLASH_ATTR connected(void *arg)
 {
     pespconn = (struct espconn *)arg;
 
-    printf("[Shell] connection established\n");
+    trace("[Shell] connection established\n");
     espconn_regist_recvcb(pespconn, received);
     espconn_regist_disconcb(pespconn, disconnected);
     espconn_regist_sentcb( pespconn, sent );
     espconn_regist_write_finish( pespconn, write_finished );
     is_connected = TRUE;
+    stdin_held = 0;             // a hold belonged to the previous connection
     send_to_stdin("WELCOME\n", 8);
 }
 
 void ICACHE_FLASH_ATTR tcp_shell_init(void)
 {
-    tcp_shell_stdin = xQueueCreate( 128, sizeof( char) );
-    stdout_buffer = (char *) os_zalloc(MAX_PACKET_SIZE);
-    stdout_pointer = 0;
+    stdin_ring = (char *) os_zalloc(TCP_SHELL_RX_SIZE);
+    tx_buffers = (char *) os_zalloc(TCP_SHELL_TX_BUFFERS * MAX_PACKET_SIZE);
+    tx_pointer = 0;
 
     masterconn.type = ESPCONN_TCP;
     masterconn.state = ESPCONN_NONE;
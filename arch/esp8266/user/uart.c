@@ -24,6 +24,7 @@
 
 #include "esp_common.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "uart.h"
 
 LOCAL int tx_fifo_count(int uart)
@@ -46,6 +47,59 @@ int uart_tx_one_char(uint8 uart, uint8 ch)
     return OK;
 }
 
+/* Forth output to UART0 goes through the tx ring, which the TX FIFO empty interrupt drains
+   into the FIFO, so that the writer only waits when the ring is full. The indices run
+   freely; only uart_write_chars moves tx_head, and only uart0_fill_tx_fifo moves tx_tail. */
+LOCAL char tx_ring[UART_TX_RING_SIZE];
+LOCAL volatile unsigned int tx_head;
+LOCAL volatile unsigned int tx_tail;
+
+/* Called with the UART interrupt masked, or from the interrupt handler. */
+LOCAL void uart0_fill_tx_fifo()
+{
+    unsigned int tail = tx_tail;
+    int room = 126 - tx_fifo_count(UART0);
+    while( tail != tx_head && room-- > 0 ) {
+        WRITE_PERI_REG(UART_FIFO(UART0), tx_ring[tail % UART_TX_RING_SIZE]);
+        tail++;
+    }
+    tx_tail = tail;
+    if( tail == tx_head ) {
+        CLEAR_PERI_REG_MASK(UART_INT_ENA(UART0), UART_TXFIFO_EMPTY_INT_ENA);
+    } else {
+        SET_PERI_REG_MASK(UART_INT_ENA(UART0), UART_TXFIFO_EMPTY_INT_ENA);
+    }
+}
+
+LOCAL void uart0_start_tx()
+{
+    ETS_UART_INTR_DISABLE();
+    uart0_fill_tx_fifo();
+    ETS_UART_INTR_ENABLE();
+}
+
+int uart_write_chars( char* buffer, int length )
+{
+    int i;
+    for( i = 0; i < length; i++ ) {
+        char ch = buffer[i];
+        if( tx_head - tx_tail >= UART_TX_RING_SIZE - 1 ) {
+            uart0_start_tx();
+            while( tx_head - tx_tail >= UART_TX_RING_SIZE - 1 ) {
+                vTaskDelay( 1 );                // ring full, let the interrupt drain it
+            }
+        }
+        if( ch == '\n' ) {
+            tx_ring[tx_head % UART_TX_RING_SIZE] = '\r';
+            tx_head++;
+        }
+        tx_ring[tx_head % UART_TX_RING_SIZE] = ch;
+        tx_head++;
+    }
+    uart0_start_tx();
+    return length;
+}
+
 void uart1_write_char(char c)
 {
     uart_tx_one_char(UART1, c);
@@ -161,24 +215,53 @@ void UART_IntrConfig(UART_Port uart_no,  UART_IntrConfTypeDef *pUARTIntrConf)
     SET_PERI_REG_MASK(UART_INT_ENA(uart_no), pUARTIntrConf->UART_IntrEnMask);
 }
 
+/* Received characters are moved from the RX FIFO into the rx ring by the interrupt handler,
+   when the FIFO passes its threshold or the line goes quiet. The indices run freely; only the
+   handler moves rx_head and only uart_read_chars moves rx_tail. While the ring is full the
+   RX interrupts stay masked, so the FIFO backs up, and with UART_RTS_FLOW_CONTROL that holds
+   the sender off instead of dropping characters. */
+LOCAL char rx_ring[UART_RX_RING_SIZE];
+LOCAL volatile unsigned int rx_head;
+LOCAL volatile unsigned int rx_tail;
+
+#define UART_RX_INTR_MASK (UART_RXFIFO_FULL_INT_ENA | UART_RXFIFO_TOUT_INT_ENA)
+
+int rx_fifo_count()
+{
+    return (READ_PERI_REG(UART_STATUS(UART0)) >> UART_RXFIFO_CNT_S)&UART_RXFIFO_CNT;
+}
+
+LOCAL void uart0_drain_rx_fifo()
+{
+    unsigned int head = rx_head;
+    int fifo_len = rx_fifo_count();
+    while( fifo_len-- > 0 && head - rx_tail < UART_RX_RING_SIZE ) {
+        rx_ring[head % UART_RX_RING_SIZE] = READ_PERI_REG(UART_FIFO(UART0)) & 0xFF;
+        head++;
+    }
+    rx_head = head;
+    if( head - rx_tail == UART_RX_RING_SIZE ) {
+        CLEAR_PERI_REG_MASK(UART_INT_ENA(UART0), UART_RX_INTR_MASK);
+    }
+}
+
 LOCAL void uart0_rx_intr_handler(void *dummy)
 {
     // uart0 and uart1 intr combine togther, when interrupt occur, see reg 0x3ff20020, bit2, bit0 represents
     // uart1 and uart0 respectively
     //
-    uint8 rcvChar;
-    uint8 fifo_len = 0;
-    uint8 fifo_tmp[128] = {0};
-
     uint32 uart_intr_status = READ_PERI_REG(UART_INT_ST(UART0)) ;
 
     while (uart_intr_status != 0x0) {
         if (UART_FRM_ERR_INT_ST == (uart_intr_status & UART_FRM_ERR_INT_ST)) {
             printf("frame error\n");
             WRITE_PERI_REG(UART_INT_CLR( UART0 ), UART_FRM_ERR_INT_CLR);
-        } else if (UART_RXFIFO_FULL_INT_ST == (uart_intr_status & UART_RXFIFO_FULL_INT_ST)) {
-            printf("full\n");
-            WRITE_PERI_REG(UART_INT_CLR(UART0), UART_RXFIFO_FULL_INT_CLR);
+        } else if (uart_intr_status & (UART_RXFIFO_FULL_INT_ST | UART_RXFIFO_TOUT_INT_ST)) {
+            uart0_drain_rx_fifo();
+            WRITE_PERI_REG(UART_INT_CLR(UART0), UART_RXFIFO_FULL_INT_CLR | UART_RXFIFO_TOUT_INT_CLR);
+        } else if (UART_TXFIFO_EMPTY_INT_ST == (uart_intr_status & UART_TXFIFO_EMPTY_INT_ST)) {
+            uart0_fill_tx_fifo();
+            WRITE_PERI_REG(UART_INT_CLR(UART0), UART_TXFIFO_EMPTY_INT_CLR);
         }
         uart_intr_status = READ_PERI_REG(UART_INT_ST(UART0)) ;
     }
@@ -191,19 +274,23 @@ void uart_init_new(void)
     UART_WaitTxFifoEmpty(UART1);
 
     UART_ConfigTypeDef uart_config;
-    uart_config.baud_rate = BIT_RATE_115200;
+    uart_config.baud_rate = UART_BAUD_RATE;
     uart_config.data_bits = UART_WordLength_8b;
     uart_config.parity    = USART_Parity_None;
     uart_config.stop_bits = USART_StopBits_1;
+#ifdef UART_RTS_FLOW_CONTROL
+    uart_config.flow_ctrl = USART_HardwareFlowControl_RTS;  // RTS drops when the FIFO holds UART_RxFlowThresh
+#else
     uart_config.flow_ctrl = USART_HardwareFlowControl_None;
+#endif
     uart_config.UART_RxFlowThresh = 120;
     uart_config.UART_InverseMask = UART_None_Inverse;
     UART_ParamConfig(UART0, &uart_config);
     UART_ParamConfig(UART1, &uart_config);
 
     UART_IntrConfTypeDef uart_intr;
-    uart_intr.UART_IntrEnMask = UART_FRM_ERR_INT_ENA | UART_RXFIFO_FULL_INT_ENA;
-    uart_intr.UART_RX_FifoFullIntrThresh = 10;
+    uart_intr.UART_IntrEnMask = UART_FRM_ERR_INT_ENA | UART_RX_INTR_MASK | UART_TXFIFO_EMPTY_INT_ENA;
+    uart_intr.UART_RX_FifoFullIntrThresh = 64;     // half the FIFO, over half a millisecond at 921600 baud
     uart_intr.UART_RX_TimeOutIntrThresh = 2;
     uart_intr.UART_TX_FifoEmptyIntrThresh = 20;
     UART_IntrConfig(UART0, &uart_intr);
@@ -226,19 +313,28 @@ void uart_init_new(void)
     */
 }
 
-int rx_fifo_count()
-{
-    return (READ_PERI_REG(UART_STATUS(UART0)) >> UART_RXFIFO_CNT_S)&UART_RXFIFO_CNT;
-}
-
 int uart_read_chars( char* buffer, int bufsize )
 {
-    int fifo_len = rx_fifo_count();
-    int count = 0;
-    while( count < bufsize && count < fifo_len )
-    {
-        uint8 rcvChar = READ_PERI_REG(UART_FIFO(UART0)) & 0xFF;
-        buffer[count++] = rcvChar;
+    unsigned int tail = rx_tail;
+    unsigned int offset = tail % UART_RX_RING_SIZE;
+    int count = rx_head - tail;
+    int first;
+    if( count > bufsize ) {
+        count = bufsize;
+    }
+    first = UART_RX_RING_SIZE - offset;
+    if( first > count ) {
+        first = count;
+    }
+    memcpy( buffer, rx_ring + offset, first );
+    memcpy( buffer + first, rx_ring, count - first );
+    rx_tail = tail + count;
+    if( count > 0 ) {
+        // in case a full ring masked them. UART_SetIntrEna reads and writes UART_INT_ENA back,
+        // which the handler also changes, so it must not run in between.
+        ETS_UART_INTR_DISABLE();
+        UART_SetIntrEna(UART0, UART_RX_INTR_MASK);
+        ETS_UART_INTR_ENABLE();
     }
     return count;
 }
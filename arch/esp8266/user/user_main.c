@@ -18,9 +18,9 @@
 #include "freertos/task.h"
 #include "forthright.h"
 #include "tcp_shell.h"
+#include "uart.h"
 
 static xTaskHandle tasks[8];
-static int primaryPort = 0;
 
 #ifdef DEBUG
 static int debugPort = 0;
@@ -28,8 +28,43 @@ static int debugPort = 0;
 static int debugPort = 1;
 #endif
 
+/* The input ring sits between the input task, which fills it from the TCP shell or the
+   primary serial port, and forthright_readChars, which empties it into the Forth input
+   buffer. Receiving thus overlaps with parsing, instead of the interpreter stalling on
+   every refill. The indices run freely, and only the input task moves input_head. */
+static char input_ring[INPUT_RING_SIZE];
+static volatile unsigned int input_head;
+static volatile unsigned int input_tail;
+
 static void ICACHE_FLASH_ATTR forthright_task( void* dummy ) {
     forthright();
+    vTaskDelete( NULL );				// only reached when there was no data segment
+}
+
+static void ICACHE_FLASH_ATTR input_task( void* dummy ) {
+    for( ;; ) {
+        unsigned int head = input_head;
+        unsigned int offset = head % INPUT_RING_SIZE;
+        int space = INPUT_RING_SIZE - ( head - input_tail );
+        int count = 0;
+        if( space > INPUT_RING_SIZE - offset ) {
+            space = INPUT_RING_SIZE - offset;		// up to the wrap
+        }
+        if( space > 0 ) {
+            if( tcp_shell_is_connected() ) {
+                count = tcp_shell_read_chars( input_ring + offset, space );
+            }
+            else {
+                count = uart_read_chars( input_ring + offset, space );
+            }
+        }
+        if( count > 0 ) {
+            input_head = head + count;
+        }
+        else {
+            vTaskDelay( 1 );
+        }
+    }
 }
 
 void ICACHE_FLASH_ATTR user_init(void) {
@@ -38,6 +73,7 @@ void ICACHE_FLASH_ATTR user_init(void) {
     tcp_shell_init();
     UART_SetPrintPort( debugPort );
     xTaskCreate( forthright_task, "forthright", 256, NULL, 2, &tasks[0] ); // create root FORTH interpreter
+    xTaskCreate( input_task, "input", 512, NULL, 2, &tasks[1] );
 }
 
 LOCAL int ICACHE_FLASH_ATTR serial_put_chars( int port, char* str, int length ) {
@@ -59,7 +95,7 @@ void ICACHE_FLASH_ATTR forthright_echo_char( char ch ) {
         }
     }
     else {
-        uart_tx_one_char( primaryPort, ch );
+        uart_write_chars( &ch, 1 );
     }
 }
 
@@ -68,16 +104,45 @@ void ICACHE_FLASH_ATTR forthright_putChar( char ch ) {
         tcp_shell_put_char(ch);
     }
     else {
-        uart_tx_one_char( primaryPort, ch );
+        uart_write_chars( &ch, 1 );
     }
 }
 
 void ICACHE_FLASH_ATTR forthright_putChars( char* str, int length ) {
+    if( (uint32) str >= FLASH_MAP && length > 0 ) {
+        // Compiled into the flash by ROM{, which only reads whole cells, so copy them out first.
+        uint32 cells[16];
+        uint32 offset = (uint32) str & 3;
+        uint32* cell = (uint32*) ( str - offset );
+        while( length > 0 ) {
+            int n = sizeof( cells ) - offset;
+            int i;
+            if( n > length ) {
+                n = length;
+            }
+            for( i = 0; i < ( offset + n + 3 ) / 4; i++ ) {
+                cells[i] = *cell++;
+            }
+            forthright_putChars( (char*) cells + offset, n );
+            length -= n;
+            offset = 0;
+        }
+        return;
+    }
     if( tcp_shell_is_connected() ) {
         tcp_shell_put_chars(str, length);
     }
     else {
-        serial_put_chars( primaryPort, str, length );
+        uart_write_chars( str, length );
+    }
+}
+
+/* The primary serial port drains its tx ring by interrupt, so only the TCP shell holds back
+   output until a packet is full.
+*/
+void ICACHE_FLASH_ATTR forthright_flush() {
+    if( tcp_shell_is_connected() ) {
+        tcp_shell_flush();
     }
 }
 
@@ -95,28 +160,40 @@ void ICACHE_FLASH_ATTR forthright_debugOut( char* str, int length ) {
     serial_put_chars( debugPort, str, length );
 }
 
-/* Reads characters from the primary serial port to the Forth Input Buffer.
+/* Moves the characters received so far from the input ring to the Forth Input Buffer, which
+   the input task has been filling from the TCP shell or the primary serial port.
 
-   This is NOT a BLOCKING operation. If there are no characters from the serial port,
-   this method will not return to the caller (typically from assembler).
+   This is NOT a BLOCKING operation. If there are no characters in the ring, this method
+   flushes the output, as Forth is idle, yields to the other tasks and returns 0, and the
+   caller (typically from assembler) will try again.
 
-   If this method is not called often enough to consume the characters from the
-   serial port, characters will be dropped/lost.
+   If this method is not called often enough, the ring fills up and the input task stops
+   reading. The serial port then buffers in its own rx ring, see uart.c, and after that holds
+   the sender off if built with UART_RTS_FLOW_CONTROL, or drops characters if not.
 
    The method returns the number of characters that was written into the 'buffer'.
 */
 int ICACHE_FLASH_ATTR forthright_readChars( char* buffer, int bufsize ) {
-    int bytesRead;
-    if( tcp_shell_is_connected() ) {
-        bytesRead = tcp_shell_read_chars(buffer, bufsize-1);
+    unsigned int tail = input_tail;
+    unsigned int offset = tail % INPUT_RING_SIZE;
+    int count = input_head - tail;
+    int first;
+    if( count == 0 ) {
+        forthright_flush();
+        taskYIELD();
+        return 0;
     }
-    else {
-        bytesRead = uart_read_chars( buffer, bufsize-1 );
+    if( count > bufsize - 1 ) {
+        count = bufsize - 1;
     }
-    if( bytesRead == 0 ) {
-        taskYIELD();
+    first = INPUT_RING_SIZE - offset;
+    if( first > count ) {
+        first = count;
     }
-    return bytesRead;
+    memcpy( buffer, input_ring + offset, first );
+    memcpy( buffer + first, input_ring, count - first );
+    input_tail = tail + count;
+    return count;
 }
 
 /* Division hardware is not present in the ESP8266 CPU, and the firmware library for it
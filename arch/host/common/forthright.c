@@ -0,0 +1,582 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/** Forthright's bootstrapper for the Linux hosted build.
+*
+* Same layout as the ESP8266 bootstrapper, except that all areas are members of one struct
+* with the system_t first, since Forth addresses on the host are offsets from the system_t.
+*/
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include "forthright.h"
+
+static struct
+{
+    system_t system;
+    char data_stack_overflow[STACK_PAGE_SIZE] __attribute__(( aligned( STACK_PAGE_SIZE ) ));
+    char data_stack_guard[STACK_PAGE_SIZE - DATA_STACK_SIZE];	// the canary is at the top
+    char data_stack[DATA_STACK_SIZE];
+    char data_stack_underflow[STACK_PAGE_SIZE];
+    char return_stack_overflow[STACK_PAGE_SIZE];
+    char return_stack_guard[STACK_PAGE_SIZE - RETURN_STACK_SIZE];
+    char return_stack[RETURN_STACK_SIZE];
+    char return_stack_underflow[STACK_PAGE_SIZE];
+    char input_buffer[INPUT_BUFFER_SIZE];
+    char data_segment[DATA_SEGMENT_SIZE];
+    char segment_heap[SEGMENT_HEAP_SIZE];
+    char rom_staging[ROM_SECTOR_SIZE];
+    uint8_t rom_relocate[ROM_RELOCATE_SIZE];	// right after it, see rom_commit()
+    char rom_segment[ROM_SEGMENT_SIZE];
+    char heap[HEAP_SIZE];
+    cell_t dictionary_index[DICTIONARY_INDEX_SIZE];
+    char word_buffer[MAX_WORD_SIZE];
+    cell_t find_key[MAX_WORD_SIZE / 4];
+} memory;
+
+#define ADDRESS_OF( member ) ( (cell_t) offsetof( typeof( memory ), member ) )
+#define CELL_AT( system, addr ) ( *(cell_t*) ( (char*) ( system ) + ( addr ) ) )
+
+/* The state of the heap, see forthright_allocate(). Offsets are from the start of the heap. */
+#define HEAP_CLASSES 7				// 16 to 1024 bytes
+#define HEAP_CLASS_MAX ( 16 << ( HEAP_CLASSES - 1 ) )
+#define HEAP_FIRST 16				// no block at 0, which ends the free lists
+
+static struct
+{
+    cell_t top;					// above the blocks carved so far
+    cell_t used;				// bytes in blocks in use
+    cell_t classes[HEAP_CLASSES];		// free blocks of each size class
+    cell_t large;				// free blocks larger than HEAP_CLASS_MAX
+    cell_t arena_base;				// where MARK-ARENA started, above the top
+    cell_t arena;				// the next free byte in the arena, or 0 if there is none
+} heap;
+
+static void set_up( int data_segment_shift )
+{
+    system_t* system = &memory.system;
+
+    system->data_segment = ADDRESS_OF( data_segment ) + data_segment_shift;
+    system->data_segment_size = DATA_SEGMENT_SIZE - data_segment_shift;
+    system->segment_chunk = DATA_SEGMENT_CHUNK;
+    system->rom_dp = ADDRESS_OF( rom_segment );
+    memset( &heap, 0, sizeof( heap ) );
+    heap.top = HEAP_FIRST;
+
+    system->data_stack = ADDRESS_OF( data_stack );
+    system->data_stack_size = DATA_STACK_SIZE;
+    CELL_AT( system, system->data_stack - 4 ) = STACK_CANARY;
+
+    system->return_stack = ADDRESS_OF( return_stack );
+    system->return_stack_size = RETURN_STACK_SIZE;
+    CELL_AT( system, system->return_stack - 4 ) = STACK_CANARY;
+
+    system->input_buffer = ADDRESS_OF( input_buffer );
+    system->input_buffer_size = INPUT_BUFFER_SIZE;
+
+    system->word_buffer = ADDRESS_OF( word_buffer );
+    system->word_buffer_size = MAX_WORD_SIZE;
+    system->find_key = ADDRESS_OF( find_key );
+
+    system->dictionary_index = ADDRESS_OF( dictionary_index );
+    system->dictionary_index_size = DICTIONARY_INDEX_SIZE;
+}
+
+void forthright()
+{
+    set_up( 0 );
+    forthright_start( &memory.system );
+}
+
+/* The saved image, see SAVE-IMAGE in esp8266.S. The same as on the device, but with offsets. */
+#define IMAGE_MAGIC 0x4d495246		// "FRIM"
+#define FILENAME_SIZE 32
+
+typedef struct
+{
+    cell_t magic;
+    cell_t builtin;			// the last word not in the data segment
+    cell_t data_segment;		// where the data segment was
+    cell_t used;			// bytes of it that follow
+    cell_t latest;
+    cell_t base;
+} image_header_t;
+
+/* Segments chained to the data segment, newest first, start with two cells: the previous one
+   and the end. DP starts after that. They are taken from segment_heap, which as they are dropped
+   newest first too, is a stack.
+*/
+#define SEGMENT_PREVIOUS( system, segment ) CELL_AT( system, segment )
+#define SEGMENT_END( system, segment ) CELL_AT( system, ( segment ) + 4 )
+
+static int in_data_segment( system_t* system, cell_t p )
+{
+    cell_t segment;
+    if( p >= system->data_segment && p < system->data_segment + system->data_segment_size ) {
+        return 1;
+    }
+    for( segment = system->segments; segment != 0; segment = SEGMENT_PREVIOUS( system, segment ) ) {
+        if( p >= segment && p < SEGMENT_END( system, segment ) ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void forthright_find_segment( system_t* system )
+{
+    if( system->rom_staging != 0 ) {
+        return;					// DP is in the ROM{ buffer, which is the segment
+    }
+    cell_t dp = system->dp;
+    cell_t segment = system->segments;
+    while( segment != 0 && ( dp < segment + 8 || dp > SEGMENT_END( system, segment ) ) ) {
+        segment = SEGMENT_PREVIOUS( system, segment );
+    }
+    system->segments = segment;
+    if( segment != 0 ) {
+        system->segment_start = segment + 8;
+        system->segment_end = SEGMENT_END( system, segment );
+    } else {
+        system->segment_start = system->data_segment;
+        system->segment_end = system->data_segment + system->data_segment_size;
+    }
+}
+
+/* Copies the ROM{ buffer to rom_segment, relocated as rom_commit() in the ESP8266 forthright.c
+   does when it writes it to the flash: only the cells that host.c marked as holding addresses. */
+static int rom_commit( system_t* system )
+{
+    cell_t staging = system->rom_staging;
+    cell_t used = ( system->dp - staging + 3 ) & ~3;
+    cell_t rom = system->rom_dp;
+    if( rom + used > ADDRESS_OF( rom_segment ) + ROM_SEGMENT_SIZE ) {
+        return -1;
+    }
+    cell_t delta = rom - staging;
+    uint8_t* relocate = memory.rom_relocate;
+    cell_t i;
+    for( i = 0; i < used / 4; i++ ) {
+        cell_t value = CELL_AT( system, staging + i * 4 );
+        if( ( relocate[i / 8] & ( 1 << ( i % 8 ) ) ) && value >= staging && value <= staging + used ) {
+            CELL_AT( system, staging + i * 4 ) = value + delta;
+        }
+    }
+    cell_t* slot = (cell_t*) ( (char*) system + system->dictionary_index );
+    for( i = 0; i < system->dictionary_index_size; i++ ) {
+        if( slot[i] >= staging && slot[i] < staging + used ) {
+            slot[i] += delta;
+        }
+    }
+    if( system->dictionary_indexed >= staging && system->dictionary_indexed < staging + used ) {
+        system->dictionary_indexed += delta;
+    }
+    if( system->latest >= staging && system->latest < staging + used ) {
+        system->latest += delta;
+    }
+    memcpy( (char*) system + rom, (char*) system + staging, used );
+    system->rom_dp = rom + used;
+    system->dp = staging;
+    system->peephole_at = 0;
+    memset( relocate, 0, ROM_RELOCATE_SIZE );
+    return 0;
+}
+
+int forthright_rom_begin( system_t* system )
+{
+    if( system->rom_staging != 0 ) {
+        return -1;
+    }
+    system->rom_ram_dp = system->dp;
+    system->rom_staging = ADDRESS_OF( rom_staging );
+    memset( memory.rom_relocate, 0, ROM_RELOCATE_SIZE );
+    system->segment_start = system->rom_staging;
+    system->segment_end = system->rom_staging + ROM_SECTOR_SIZE;
+    system->dp = system->rom_staging;
+    system->peephole_at = 0;
+    return 0;
+}
+
+int forthright_rom_end( system_t* system )
+{
+    cell_t staging = system->rom_staging;
+    if( staging == 0 ) {
+        return -1;
+    }
+    int result = rom_commit( system );
+    if( result < 0 ) {
+        while( system->latest >= staging && system->latest < staging + ROM_SECTOR_SIZE ) {
+            system->latest = CELL_AT( system, system->latest );
+        }
+        system->dictionary_indexed = 0;
+    }
+    system->rom_staging = 0;
+    system->dp = system->rom_ram_dp;
+    system->peephole_at = 0;
+    forthright_find_segment( system );
+    return result;
+}
+
+int forthright_make_room( system_t* system )
+{
+    if( system->rom_staging != 0 ) {
+        if( system->dp + DATA_SEGMENT_SLACK <= system->rom_staging + ROM_SECTOR_SIZE ) {
+            return 0;
+        }
+        return rom_commit( system );
+    }
+    forthright_find_segment( system );
+    cell_t dp = system->dp;
+    int inside = dp >= system->segment_start && dp < system->segment_end;
+    if( inside && dp + DATA_SEGMENT_SLACK <= system->segment_end ) {
+        return 0;
+    }
+    cell_t size = system->segment_chunk & ~3;
+    cell_t segment = system->segments ? SEGMENT_END( system, system->segments ) : ADDRESS_OF( segment_heap );
+    if( size >= 8 + DATA_SEGMENT_SLACK && segment + size <= ADDRESS_OF( segment_heap ) + SEGMENT_HEAP_SIZE ) {
+        SEGMENT_PREVIOUS( system, segment ) = system->segments;
+        SEGMENT_END( system, segment ) = segment + size;
+        system->segments = segment;
+        system->segment_start = segment + 8;
+        system->segment_end = segment + size;
+        system->dp = segment + 8;
+        return 0;
+    }
+    return inside ? 0 : -1;			// what is left will have to do
+}
+
+cell_t forthright_data_segment_size( system_t* system )
+{
+    cell_t size = system->data_segment_size;
+    cell_t segment;
+    forthright_find_segment( system );
+    for( segment = system->segments; segment != 0; segment = SEGMENT_PREVIOUS( system, segment ) ) {
+        size += SEGMENT_END( system, segment ) - segment;
+    }
+    return size;
+}
+
+/* The last of the built-in words, which the words in the data segment are defined on top of. */
+static cell_t builtin_latest( system_t* system )
+{
+    cell_t header = system->latest;
+    while( in_data_segment( system, header ) ) {
+        header = CELL_AT( system, header );
+    }
+    return header;
+}
+
+static int open_image( const char* filename, int length, int flags )
+{
+    char name[FILENAME_SIZE + 1];
+    if( length > FILENAME_SIZE ) {
+        return -1;
+    }
+    memcpy( name, filename, length );
+    name[length] = 0;
+    return open( name, flags, 0644 );
+}
+
+int forthright_save_image( system_t* system, const char* filename, int length )
+{
+    forthright_find_segment( system );
+    if( system->segments != 0 || system->rom_staging != 0 ) {
+        return -1;				// only the data segment itself is saved
+    }
+    image_header_t header;
+    header.magic = IMAGE_MAGIC;
+    header.builtin = builtin_latest( system );
+    header.data_segment = system->data_segment;
+    header.used = system->dp - system->data_segment;
+    header.latest = system->latest;
+    header.base = system->base;
+
+    int fd = open_image( filename, length, O_WRONLY | O_CREAT | O_TRUNC );
+    if( fd < 0 ) {
+        return -1;
+    }
+    int ok = write( fd, &header, sizeof( header ) ) == sizeof( header )
+        && write( fd, (char*) system + system->data_segment, header.used ) == header.used;
+    close( fd );
+    return ok ? 0 : -1;
+}
+
+int forthright_load_image( system_t* system, const char* filename, int length )
+{
+    image_header_t header;
+    if( system->rom_staging != 0 ) {
+        return -1;
+    }
+    int fd = open_image( filename, length, O_RDONLY );
+    if( fd < 0 ) {
+        return -1;
+    }
+    // The cells that hold addresses can't be told from numbers, so they can't be moved along if
+    // the data segment has moved since. The image is refused instead.
+    if( read( fd, &header, sizeof( header ) ) != sizeof( header ) || header.magic != IMAGE_MAGIC
+        || header.builtin != builtin_latest( system ) || header.data_segment != system->data_segment
+        || header.used > system->data_segment_size ) {
+        close( fd );
+        return -1;
+    }
+    int ok = read( fd, (char*) system + system->data_segment, header.used ) == header.used;
+    close( fd );
+
+    system->dictionary_indexed = 0;			// The (FIND) index is stale either way,
+    system->peephole_at = 0;				// and so is the previous instruction.
+    if( !ok ) {
+        system->latest = header.builtin;
+        system->dp = system->data_segment;
+        forthright_find_segment( system );		// drops the chained segments
+        return -1;
+    }
+
+    system->latest = header.latest;
+    system->dp = system->data_segment + header.used;
+    system->base = header.base;
+    forthright_find_segment( system );
+    return 0;
+}
+
+/* Blocks start with a cell holding their size, a multiple of 16 which includes that cell, and
+   with the lowest bit set while in use. Blocks of up to HEAP_CLASS_MAX bytes come in powers of
+   two, and a freed one goes on the free list of its size class, for the next ALLOCATE of that
+   class to take in O(1). Larger ones go on one list, which is searched first fit, and split. The
+   free lists are linked through the cell after the size, and end with 0. Other blocks are carved
+   from the top, which FREE lowers again when it frees the block just below it.
+*/
+#define HEAP_CELL( offset ) CELL_AT( &memory.system, ADDRESS_OF( heap ) + ( offset ) )
+
+static cell_t heap_class( cell_t block )
+{
+    return 28 - __builtin_clz( block - 1 );	// 16 is class 0
+}
+
+static cell_t heap_size_of( cell_t size )
+{
+    cell_t size_of = ( size + 4 + 15 ) & ~15;
+    return size_of <= HEAP_CLASS_MAX ? 16 << heap_class( size_of ) : size_of;
+}
+
+/* While there is an arena, blocks are taken one after the other from above the top, each after a
+   cell with its size, and only RELEASE-ARENA gives them back. */
+static cell_t in_arena( cell_t addr )
+{
+    cell_t offset = addr - ADDRESS_OF( heap );
+    return heap.arena != 0 && offset >= heap.arena_base + 4 && offset < heap.arena;
+}
+
+static cell_t arena_allocate( cell_t size )
+{
+    cell_t size_of = ( size + 4 + 3 ) & ~3;
+    if( size < 0 || size > HEAP_SIZE || heap.arena + size_of > HEAP_SIZE ) {
+        return 0;
+    }
+    HEAP_CELL( heap.arena ) = size_of;
+    heap.arena += size_of;
+    return ADDRESS_OF( heap ) + heap.arena - size_of + 4;
+}
+
+static cell_t heap_block( cell_t addr )
+{
+    cell_t block = addr - 4 - ADDRESS_OF( heap );
+    if( block < 0 || block >= heap.top || ( block & 15 ) != 0 || ( HEAP_CELL( block ) & 1 ) == 0 ) {
+        return -1;
+    }
+    return block;
+}
+
+/* Takes a block from the size classes or the top. While there is an arena, the top can only
+   grow up to where the arena starts. */
+static cell_t heap_allocate( cell_t size )
+{
+    if( size < 0 || size > HEAP_SIZE ) {
+        return 0;
+    }
+    cell_t size_of = heap_size_of( size );
+    cell_t block;
+    if( size_of <= HEAP_CLASS_MAX ) {
+        cell_t class = heap_class( size_of );
+        block = heap.classes[class];
+        if( block != 0 ) {
+            heap.classes[class] = HEAP_CELL( block + 4 );
+            goto found;
+        }
+    } else {
+        cell_t* link = &heap.large;
+        for( block = *link; block != 0; link = &HEAP_CELL( block + 4 ), block = *link ) {
+            cell_t left = HEAP_CELL( block ) - size_of;
+            if( left >= 0 ) {
+                *link = HEAP_CELL( block + 4 );
+                if( left > HEAP_CLASS_MAX ) {
+                    HEAP_CELL( block + size_of ) = left;	// the rest stays free
+                    HEAP_CELL( block + size_of + 4 ) = heap.large;
+                    heap.large = block + size_of;
+                } else {
+                    size_of += left;
+                }
+                goto found;
+            }
+        }
+    }
+    if( heap.top + size_of > ( heap.arena != 0 ? heap.arena_base : HEAP_SIZE ) ) {
+        return 0;
+    }
+    block = heap.top;
+    heap.top += size_of;
+
+found:
+    HEAP_CELL( block ) = size_of | 1;
+    heap.used += size_of;
+    return ADDRESS_OF( heap ) + block + 4;
+}
+
+cell_t forthright_allocate( system_t* system, cell_t size )
+{
+    if( heap.arena != 0 ) {
+        return arena_allocate( size );
+    }
+    return heap_allocate( size );
+}
+
+int forthright_free( system_t* system, cell_t addr )
+{
+    if( in_arena( addr ) ) {
+        return 0;				// until RELEASE-ARENA
+    }
+    cell_t block = heap_block( addr );
+    if( block < 0 ) {
+        return -1;
+    }
+    cell_t size_of = HEAP_CELL( block ) & ~1;
+    HEAP_CELL( block ) = size_of;
+    heap.used -= size_of;
+    if( block + size_of == heap.top ) {
+        heap.top = block;
+    } else if( size_of <= HEAP_CLASS_MAX ) {
+        cell_t class = heap_class( size_of );
+        HEAP_CELL( block + 4 ) = heap.classes[class];
+        heap.classes[class] = block;
+    } else {
+        HEAP_CELL( block + 4 ) = heap.large;
+        heap.large = block;
+    }
+    return 0;
+}
+
+cell_t forthright_resize( system_t* system, cell_t addr, cell_t size )
+{
+    if( in_arena( addr ) ) {
+        cell_t block = addr - 4 - ADDRESS_OF( heap );
+        cell_t size_of = HEAP_CELL( block );
+        cell_t wanted = ( size + 4 + 3 ) & ~3;
+        if( size < 0 || size + 4 <= size_of ) {
+            return size < 0 ? 0 : addr;
+        }
+        if( block + size_of == heap.arena && block + wanted <= HEAP_SIZE ) {
+            HEAP_CELL( block ) = wanted;		// the last block grows where it is
+            heap.arena = block + wanted;
+            return addr;
+        }
+        cell_t moved = arena_allocate( size );
+        if( moved != 0 ) {
+            memcpy( (char*) system + moved, (char*) system + addr, size_of - 4 );
+        }
+        return moved;
+    }
+    cell_t block = heap_block( addr );
+    if( block < 0 || size < 0 || size > HEAP_SIZE ) {
+        return 0;
+    }
+    cell_t size_of = HEAP_CELL( block ) & ~1;
+    if( size + 4 <= size_of ) {
+        return addr;
+    }
+    cell_t wanted = heap_size_of( size );
+    if( block + size_of == heap.top && block + wanted <= ( heap.arena != 0 ? heap.arena_base : HEAP_SIZE ) ) {
+        HEAP_CELL( block ) = wanted | 1;		// the top block grows where it is
+        heap.used += wanted - size_of;
+        heap.top = block + wanted;
+        return addr;
+    }
+    cell_t moved = heap_allocate( size );		// not into the arena, which it would not outlive
+    if( moved != 0 ) {
+        memcpy( (char*) system + moved, (char*) system + addr, size_of - 4 );
+        forthright_free( system, addr );
+    }
+    return moved;
+}
+
+void forthright_heap_stats( system_t* system, cell_t* stats )
+{
+    cell_t in_use = heap.arena != 0 ? heap.arena - heap.arena_base : 0;
+    cell_t largest = HEAP_SIZE - ( heap.arena != 0 ? heap.arena : heap.top );
+    cell_t block;
+    int class;
+    for( class = 0; class < HEAP_CLASSES; class++ ) {
+        if( heap.classes[class] != 0 && ( 16 << class ) > largest ) {
+            largest = 16 << class;
+        }
+    }
+    for( block = heap.large; block != 0; block = HEAP_CELL( block + 4 ) ) {
+        if( HEAP_CELL( block ) > largest ) {
+            largest = HEAP_CELL( block );
+        }
+    }
+    stats[0] = heap.used + in_use;
+    stats[1] = HEAP_SIZE - HEAP_FIRST - heap.used - in_use;
+    stats[2] = largest > 4 ? largest - 4 : 0;
+}
+
+cell_t forthright_mark_arena( system_t* system )
+{
+    if( heap.arena == 0 ) {
+        heap.arena_base = heap.arena = heap.top;
+    }
+    return ADDRESS_OF( heap ) + heap.arena;
+}
+
+int forthright_release_arena( system_t* system, cell_t mark )
+{
+    cell_t offset = mark - ADDRESS_OF( heap );
+    if( heap.arena == 0 || offset < heap.arena_base || offset > heap.arena ) {
+        return -1;
+    }
+    heap.arena = offset == heap.arena_base ? 0 : offset;
+    return 0;
+}
+
+#ifdef FORTHRIGHT_IMAGE
+/* Compiles forthright.f twice, the second time with the data segment IMAGE_SHIFT bytes further up,
+   and prints the ROM image for the ESP8266. See forthright_write_image(). */
+#define IMAGE_SHIFT 4096
+
+static typeof( memory ) first_run;
+
+void forthright_image()
+{
+    set_up( 0 );
+    forthright_start( &memory.system );
+    first_run = memory;
+
+    memset( &memory, 0, sizeof( memory ) );
+    set_up( IMAGE_SHIFT );
+    forthright_start( &memory.system );
+    forthright_write_image( &first_run.system );
+}
+#endif
@@ -0,0 +1,226 @@
+#ifndef __FORTHRIGHT_H__
+#define __FORTHRIGHT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//   FSTATE          Is the interpreter executing code (0) or compiling a word (non-zero)?
+//   LATEST          Points to the latest (most recently defined) word in the dictionary.
+//   DP              Points to the next free byte of memory.  When compiling, compiled words go here.
+//   S0              Stores the address of the top of the parameter stack.
+//   BASE            The current base for printing and reading numbers.
+
+#define MAX_WORD_SIZE 32
+#ifndef DATA_SEGMENT_SIZE
+#define DATA_SEGMENT_SIZE 65536		// The host is not short of RAM, and benchmarks compile long words.
+#endif
+#ifndef DATA_SEGMENT_CHUNK
+#define DATA_SEGMENT_CHUNK 2048		// chained when the data segment is full, see segment-chunk
+#endif
+#define DATA_SEGMENT_SLACK 256		// header, chains a segment when less than this is left
+#define SEGMENT_HEAP_SIZE 65536		// where chained segments come from, the host's heap
+#define DATA_STACK_SIZE 512
+#define RETURN_STACK_SIZE 512
+#define STACK_PAGE_SIZE 4096		// each stack ends a page, between guard pages, see guard_stacks()
+#define STACK_CANARY 0x57ac6ead		// in the cell below each stack, checked by INTERPRET
+#ifndef INPUT_BUFFER_SIZE
+#define INPUT_BUFFER_SIZE 256
+#endif
+#define DICTIONARY_INDEX_SIZE 1024	// slots in the hash index over the word names, a power of 2
+#ifndef ROM_SEGMENT_SIZE
+#define ROM_SEGMENT_SIZE 65536		// stands in for the flash that ROM{ compiles to on the device
+#endif
+#define ROM_SECTOR_SIZE 4096
+#define ROM_RELOCATE_SIZE ( ROM_SECTOR_SIZE / 32 )	// after the buffer, a bit per cell, see ROM{
+#ifndef HEAP_SIZE
+#define HEAP_SIZE 65536			// for ALLOCATE, FREE and RESIZE
+#endif
+
+#ifndef FORTHRIGHT_VERSION_MAJOR
+#define FORTHRIGHT_VERSION_MAJOR 1
+#endif
+
+/* Forth cells are 32 bits, exactly as on the ESP8266, so that forthright.f (which is full of
+ * "4+" and "4 *") runs unmodified on a 64-bit host.
+ *
+ * Forth addresses can therefore not be native pointers. Instead, the system_t is placed at the
+ * bottom of one contiguous memory area, and every Forth address is a byte offset from the
+ * system_t. The members that are "void*" on the device are cells holding such offsets here,
+ * which keeps the offsets below identical to esp8266.ainc.
+ */
+typedef int32_t cell_t;
+typedef uint32_t ucell_t;
+
+typedef struct
+{
+    cell_t data_segment;  		// offset 0
+    cell_t data_segment_size;		// offset 4
+
+    cell_t data_stack;			// offset 8
+    cell_t data_stack_size;		// offset 12
+
+    cell_t return_stack;		// offset 16
+    cell_t return_stack_size;		// offset 20
+
+    cell_t input_buffer;		// offset 24
+    cell_t input_buffer_size;		// offset 28
+
+    cell_t word_buffer;			// offset 32
+    cell_t word_buffer_size;		// offset 36
+
+    cell_t word_buffer_ptr;		// offset 40
+    cell_t word_buffer_counter;		// offset 44
+
+    // System variables.
+    cell_t state;			// offset 48
+    cell_t latest;			// offset 52
+    cell_t dp;				// offset 56
+    cell_t s0;				// offset 60
+    cell_t base;			// offset 64
+
+    cell_t currkey;			// offset 68
+    cell_t bufftop;			// offset 72
+    cell_t interpret_is_lit;		// offset 76
+    cell_t initializing;		// offset 80
+    cell_t echo;			// offset 84
+
+    cell_t peephole_at;			// offset 88
+    cell_t peephole_end;		// offset 92
+
+    cell_t dictionary_index;		// offset 96
+    cell_t dictionary_index_size;	// offset 100
+    cell_t dictionary_index_used;	// offset 104
+    cell_t dictionary_indexed;		// offset 108
+    cell_t find_key;			// offset 112
+
+    cell_t segment_start;		// offset 116, the segment that DP is in
+    cell_t segment_end;			// offset 120
+    cell_t segments;			// offset 124, the newest segment chained to the data segment
+    cell_t segment_chunk;		// offset 128, bytes to chain when full, 0 never
+
+    cell_t rom_staging;			// offset 132, the sector DP is in after ROM{, or 0
+    cell_t rom_dp;			// offset 136, the next free byte in rom_segment
+    cell_t rom_ram_dp;			// offset 140, DP to go back to at }ROM
+
+} system_t;
+
+void forthright();
+
+/* With FORTHRIGHT_IMAGE, compiles forthright.f and prints the resulting dictionary as gas source,
+   for the ESP8266 to boot with. */
+void forthright_image();
+
+void forthright_write_image( const system_t* first_run );
+
+/* Writes the words compiled into the data segment, with LATEST, DP and BASE, to the file.
+   Returns 0, or -1 if the file can't be written or segments have been chained to the data segment.
+*/
+int forthright_save_image( system_t* system, const char* filename, int length );
+
+/* Reads the file written by forthright_save_image() into the data segment, and replaces the words
+   in it. Returns 0, or -1 if the file can't be read, was saved with the data segment somewhere else
+   or on top of other built-in words. If the file is cut short, the data segment is left empty.
+*/
+int forthright_load_image( system_t* system, const char* filename, int length );
+
+/* Points segment_start and segment_end at the segment that DP is in, and drops the chained
+   segments above it, which FORGET leaves empty.
+*/
+void forthright_find_segment( system_t* system );
+
+/* Makes room for a definition at DP, by chaining a new segment of segment_chunk bytes to the data
+   segment when less than DATA_SEGMENT_SLACK bytes are left, or after ROM{ by copying the buffer to
+   rom_segment. Returns 0, or -1 if it is full.
+*/
+int forthright_make_room( system_t* system );
+
+/* The size of the data segment and all segments chained to it. */
+cell_t forthright_data_segment_size( system_t* system );
+
+/* Points DP at a sector sized buffer, which forthright_make_room() copies to rom_segment when it
+   is full, with its cells relocated to where it ends up, as the device writes it to the flash.
+   Returns 0, or -1 if already compiling to ROM.
+*/
+int forthright_rom_begin( system_t* system );
+
+/* Copies what is left in the buffer to rom_segment and points DP back where it was at ROM{.
+   Returns 0, or -1 if not compiling to ROM or rom_segment is full, in which case the words in the
+   buffer are dropped.
+*/
+int forthright_rom_end( system_t* system );
+
+/* ALLOCATE, FREE and RESIZE, from the heap. forthright_allocate() and forthright_resize() return
+   the address of a block of at least size bytes, or 0 if there is none. forthright_resize() leaves
+   the block at addr as it is then, and otherwise frees it if the data had to be moved. Both
+   forthright_free() and forthright_resize() fail, with -1 and 0, if addr is not an allocated block.
+*/
+cell_t forthright_allocate( system_t* system, cell_t size );
+
+int forthright_free( system_t* system, cell_t addr );
+
+cell_t forthright_resize( system_t* system, cell_t addr, cell_t size );
+
+/* Fills in the bytes allocated, including the cell before each block, the bytes free, and the
+   largest block that can be allocated. The difference between the last two is fragmentation. */
+void forthright_heap_stats( system_t* system, cell_t* stats );
+
+/* MARK-ARENA and RELEASE-ARENA. From the first forthright_mark_arena(), ALLOCATE and RESIZE take
+   blocks from the free heap above the top, one after the other, and FREE leaves them be. Each
+   returns a mark, and forthright_release_arena() gives back everything allocated since the mark
+   at once, and ends the arena at the first. Returns 0, or -1 if the mark is not in the arena.
+*/
+cell_t forthright_mark_arena( system_t* system );
+
+int forthright_release_arena( system_t* system, cell_t mark );
+
+int forthright_divide( int a, int b );
+
+int forthright_modulo( int a, int b );
+
+/* Runs the interpreter until the input is exhausted. The system_t must be the first thing in the
+   memory area that holds the stacks, buffers and data segment it refers to.
+*/
+void forthright_start( system_t* );
+
+/* Reads characters from standard input to the Forth Input Buffer.
+
+   This is a BLOCKING operation.
+
+   The method returns the number of characters that was written into the 'buffer', or -1 at
+   end of input, which makes the interpreter return to the caller of forthright_start().
+*/
+int forthright_readChars( char* buffer, int bufsize );
+
+/* Echo character is used to send validation back to the source.
+ * On the host, the terminal (or the pipe) already shows the input, so nothing is echoed.
+ */
+void forthright_echo_char( char ch );
+
+void forthright_putChar( char ch );
+
+/*
+ * Outputs the characters in str argument.
+ */
+void forthright_putChars( char* str, int length );
+
+/*
+ * Sends any buffered output on its way. Standard output is buffered by stdio.
+ */
+void forthright_flush();
+
+/* Sends the characters to standard error, which is the host's equivalent of the
+   secondary serial port.
+*/
+void forthright_debugOut( char* str, int length  );
+
+/* The bootstrap Forth source, i.e. forthright.f, NUL terminated. Generated by the Makefile. */
+extern const char forthright_source[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+/* Just enough of the ESP8266 SDK for the shell's and the file system's C code to compile on the
+   host, see ../tcp_shell_test.c and ../spiffs_bench.c. */
+#ifndef __FAKE_ESP_COMMON_H__
+#define __FAKE_ESP_COMMON_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spi_flash.h"
+
+typedef uint8_t uint8;
+typedef int8_t sint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+
+#define LOCAL static
+#define ICACHE_FLASH_ATTR
+#define TRUE true
+#define FALSE false
+
+#define os_zalloc( size ) calloc( 1, size )
+
+#endif
@@ -0,0 +1,44 @@
+/* The part of the SDK's espconn API that tcp_shell.c uses, implemented by ../fake_espconn.c. */
+#ifndef __FAKE_ESPCONN_H__
+#define __FAKE_ESPCONN_H__
+
+#include "esp_common.h"
+
+#define ESPCONN_OK 0
+#define ESPCONN_MAXNUM -7
+
+enum espconn_type { ESPCONN_INVALID = 0, ESPCONN_TCP = 0x10, ESPCONN_UDP = 0x20 };
+
+enum espconn_state { ESPCONN_NONE, ESPCONN_WAIT, ESPCONN_LISTEN, ESPCONN_CONNECT, ESPCONN_WRITE,
+                     ESPCONN_READ, ESPCONN_CLOSE };
+
+typedef void (*espconn_connect_callback)( void *arg );
+typedef void (*espconn_reconnect_callback)( void *arg, sint8 err );
+typedef void (*espconn_recv_callback)( void *arg, char *pdata, unsigned short len );
+typedef void (*espconn_sent_callback)( void *arg );
+
+typedef struct _esp_tcp {
+    int local_port;
+} esp_tcp;
+
+struct espconn {
+    enum espconn_type type;
+    enum espconn_state state;
+    union {
+        esp_tcp *tcp;
+    } proto;
+    void *reverse;
+};
+
+sint8 espconn_accept( struct espconn *espconn );
+sint8 espconn_send( struct espconn *espconn, uint8 *psent, uint16 length );
+sint8 espconn_regist_time( struct espconn *espconn, uint32 interval, uint8 type_flag );
+sint8 espconn_regist_connectcb( struct espconn *espconn, espconn_connect_callback connect_cb );
+sint8 espconn_regist_disconcb( struct espconn *espconn, espconn_connect_callback discon_cb );
+sint8 espconn_regist_recvcb( struct espconn *espconn, espconn_recv_callback recv_cb );
+sint8 espconn_regist_sentcb( struct espconn *espconn, espconn_sent_callback sent_cb );
+sint8 espconn_regist_write_finish( struct espconn *espconn, espconn_connect_callback write_finish_fn );
+sint8 espconn_recv_hold( struct espconn *espconn );
+sint8 espconn_recv_unhold( struct espconn *espconn );
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __FAKE_TASK_H__
+#define __FAKE_TASK_H__
+
+typedef unsigned int portTickType;
+
+/* Time passes for the fake network, see ../fake_espconn.c. */
+void vTaskDelay( portTickType ticks );
+
+#endif
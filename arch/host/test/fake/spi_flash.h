@@ -0,0 +1,20 @@
+/* The SDK's flash calls, on the RAM flash in ../fake_flash.c. */
+#ifndef __FAKE_SPI_FLASH_H__
+#define __FAKE_SPI_FLASH_H__
+
+#include <stdint.h>
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum
+{
+    SPI_FLASH_RESULT_OK,
+    SPI_FLASH_RESULT_ERR,
+    SPI_FLASH_RESULT_TIMEOUT
+} SpiFlashOpResult;
+
+SpiFlashOpResult spi_flash_erase_sector( uint16_t sec );
+SpiFlashOpResult spi_flash_write( uint32_t des_addr, uint32_t* src_addr, uint32_t size );
+SpiFlashOpResult spi_flash_read( uint32_t src_addr, uint32_t* des_addr, uint32_t size );
+
+#endif
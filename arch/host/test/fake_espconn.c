@@ -0,0 +1,159 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* A fake espconn, with a single connection. Like the real one it keeps a pointer to the data
+   of each send until the sent callback, and only then is the data copied to fake_wire, so a
+   packet reused too early shows up as corrupt output. Time passes, and sends are acknowledged,
+   only when the shell waits in vTaskDelay(). */
+
+#include "espconn.h"
+#include "freertos/task.h"
+#include "tcp_shell.h"
+#include "fake_espconn.h"
+
+#define MAX_IN_FLIGHT 64
+
+char fake_wire[FAKE_WIRE_SIZE];
+int fake_wire_length;
+int fake_window = MAX_IN_FLIGHT;
+int fake_in_flight;
+int fake_max_in_flight;
+int fake_sends;
+int fake_short_sends;
+int fake_refused;
+int fake_delays;
+int fake_held;
+
+static struct espconn client;
+static espconn_connect_callback connect_cb;
+static espconn_connect_callback discon_cb;
+static espconn_recv_callback recv_cb;
+static espconn_sent_callback sent_cb;
+
+static struct {
+    uint8 *data;
+    uint16 length;
+} in_flight[MAX_IN_FLIGHT];
+
+sint8 espconn_accept( struct espconn *espconn )
+{
+    return ESPCONN_OK;
+}
+
+sint8 espconn_send( struct espconn *espconn, uint8 *psent, uint16 length )
+{
+    if( fake_in_flight >= fake_window ) {
+        fake_refused++;
+        return ESPCONN_MAXNUM;
+    }
+    in_flight[fake_in_flight].data = psent;
+    in_flight[fake_in_flight].length = length;
+    fake_in_flight++;
+    if( fake_in_flight > fake_max_in_flight ) {
+        fake_max_in_flight = fake_in_flight;
+    }
+    fake_sends++;
+    if( length < MAX_PACKET_SIZE ) {
+        fake_short_sends++;
+    }
+    return ESPCONN_OK;
+}
+
+int fake_ack()
+{
+    if( fake_in_flight == 0 ) {
+        return 0;
+    }
+    memcpy( fake_wire + fake_wire_length, in_flight[0].data, in_flight[0].length );
+    fake_wire_length += in_flight[0].length;
+    fake_in_flight--;
+    memmove( in_flight, in_flight + 1, fake_in_flight * sizeof( in_flight[0] ) );
+    sent_cb( &client );
+    return 1;
+}
+
+void vTaskDelay( portTickType ticks )
+{
+    fake_delays++;
+    if( !fake_ack() ) {
+        fprintf( stderr, "vTaskDelay: waiting with nothing in flight\n" );
+        exit( 1 );
+    }
+}
+
+void fake_connect()
+{
+    client.type = ESPCONN_TCP;
+    client.state = ESPCONN_CONNECT;
+    connect_cb( &client );
+}
+
+void fake_receive( char* data, int length )
+{
+    recv_cb( &client, data, length );
+}
+
+void fake_disconnect()
+{
+    client.state = ESPCONN_CLOSE;
+    discon_cb( &client );
+}
+
+sint8 espconn_regist_time( struct espconn *espconn, uint32 interval, uint8 type_flag )
+{
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_connectcb( struct espconn *espconn, espconn_connect_callback cb )
+{
+    connect_cb = cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_disconcb( struct espconn *espconn, espconn_connect_callback cb )
+{
+    discon_cb = cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_recvcb( struct espconn *espconn, espconn_recv_callback cb )
+{
+    recv_cb = cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_sentcb( struct espconn *espconn, espconn_sent_callback cb )
+{
+    sent_cb = cb;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_regist_write_finish( struct espconn *espconn, espconn_connect_callback cb )
+{
+    return ESPCONN_OK;
+}
+
+sint8 espconn_recv_hold( struct espconn *espconn )
+{
+    fake_held = 1;
+    return ESPCONN_OK;
+}
+
+sint8 espconn_recv_unhold( struct espconn *espconn )
+{
+    fake_held = 0;
+    return ESPCONN_OK;
+}
@@ -0,0 +1,30 @@
+/* The other end of the fake espconn layer, for the tests to drive the network and see what
+   went over it. */
+#ifndef __FAKE_ESPCONN_TEST_H__
+#define __FAKE_ESPCONN_TEST_H__
+
+#define FAKE_WIRE_SIZE 65536
+
+extern char fake_wire[FAKE_WIRE_SIZE];	// everything sent, copied when acknowledged
+extern int fake_wire_length;
+extern int fake_window;			// sends espconn accepts before ESPCONN_MAXNUM
+extern int fake_in_flight;
+extern int fake_max_in_flight;
+extern int fake_sends;
+extern int fake_short_sends;		// sends of less than MAX_PACKET_SIZE
+extern int fake_refused;		// sends refused with ESPCONN_MAXNUM
+extern int fake_delays;
+extern int fake_held;
+
+/* A client connects to the shell. */
+void fake_connect();
+
+/* The oldest send in flight is acknowledged, and the shell told so. Returns 0 if none. */
+int fake_ack();
+
+/* A segment arrives from the client. */
+void fake_receive( char* data, int length );
+
+void fake_disconnect();
+
+#endif
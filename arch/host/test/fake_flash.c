@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* A NOR flash in RAM, behind the SDK's spi_flash_* calls. Like the real one, erasing sets a
+   sector to all 1 bits, and programming can only clear bits, so a write is ANDed into what is
+   there. Like the SDK, it only takes whole, aligned words. Each call is counted, and timed and
+   costed with the figures in fake_flash.h. */
+
+#include <string.h>
+#include "spi_flash.h"
+#include "fake_flash.h"
+
+uint8_t fake_flash[FAKE_FLASH_SIZE];
+fake_flash_stats_t fake_flash_stats;
+
+void fake_flash_reset()
+{
+    memset( fake_flash, 0xff, sizeof( fake_flash ) );
+    memset( &fake_flash_stats, 0, sizeof( fake_flash_stats ) );
+}
+
+static int whole_words( uint32_t addr, uint32_t* p, uint32_t size )
+{
+    if( addr % 4 != 0 || (uintptr_t) p % 4 != 0 || size % 4 != 0 || addr > FAKE_FLASH_SIZE - size ) {
+        fake_flash_stats.refused++;
+        return 0;
+    }
+    return 1;
+}
+
+static void busy( double us, double ma )
+{
+    fake_flash_stats.busy_us += us;
+    fake_flash_stats.energy_uj += us * ma * FAKE_FLASH_VOLTS / 1000;
+}
+
+SpiFlashOpResult spi_flash_read( uint32_t src_addr, uint32_t* des_addr, uint32_t size )
+{
+    if( !whole_words( src_addr, des_addr, size ) ) {
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memcpy( des_addr, fake_flash + src_addr, size );
+    fake_flash_stats.reads++;
+    fake_flash_stats.read_bytes += size;
+    busy( FAKE_FLASH_READ_US + size * FAKE_FLASH_READ_US_PER_BYTE, FAKE_FLASH_READ_MA );
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write( uint32_t des_addr, uint32_t* src_addr, uint32_t size )
+{
+    const uint8_t* src = (const uint8_t*) src_addr;
+    uint32_t i;
+    if( !whole_words( des_addr, src_addr, size ) ) {
+        return SPI_FLASH_RESULT_ERR;
+    }
+    for( i = 0; i < size; i++ ) {
+        uint8_t old = fake_flash[des_addr + i];
+        if( src[i] != 0xFF ) {
+            // 0xFF pads a write out to whole words, and leaves the byte be on purpose.
+            fake_flash_stats.lost_bits += __builtin_popcount( src[i] & ~old );
+        }
+        fake_flash[des_addr + i] = old & src[i];
+        if( i == 0 || ( des_addr + i ) % FAKE_FLASH_PAGE_SIZE == 0 ) {
+            busy( FAKE_FLASH_PROGRAM_US, FAKE_FLASH_PROGRAM_MA );	// a page program command
+        }
+    }
+    fake_flash_stats.writes++;
+    fake_flash_stats.written_bytes += size;
+    busy( size * FAKE_FLASH_PROGRAM_US_PER_BYTE, FAKE_FLASH_PROGRAM_MA );
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_erase_sector( uint16_t sec )
+{
+    if( (uint32_t) sec >= FAKE_FLASH_SIZE / SPI_FLASH_SEC_SIZE ) {
+        fake_flash_stats.refused++;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memset( fake_flash + sec * SPI_FLASH_SEC_SIZE, 0xff, SPI_FLASH_SEC_SIZE );
+    fake_flash_stats.erases++;
+    busy( FAKE_FLASH_ERASE_US, FAKE_FLASH_ERASE_MA );
+    return SPI_FLASH_RESULT_OK;
+}
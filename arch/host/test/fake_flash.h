@@ -0,0 +1,42 @@
+/* The other end of the fake flash, for the benchmarks to see what went over the SPI bus. */
+#ifndef __FAKE_FLASH_TEST_H__
+#define __FAKE_FLASH_TEST_H__
+
+#include <stdint.h>
+
+#define FAKE_FLASH_SIZE 0x400000	// 4 MB, as on an ESP-12
+#define FAKE_FLASH_PAGE_SIZE 256	// programmed a page at a time
+
+/* Rough figures for a SPI NOR flash like the ESP-12's, at 40 MHz QIO and 3.3 V, typical rather
+   than worst case. They are for comparing one way of using the flash with another. */
+#define FAKE_FLASH_READ_US 2.0			// command, address and the SDK call
+#define FAKE_FLASH_READ_US_PER_BYTE 0.05
+#define FAKE_FLASH_PROGRAM_US 30.0		// per page programmed
+#define FAKE_FLASH_PROGRAM_US_PER_BYTE 2.5
+#define FAKE_FLASH_ERASE_US 45000.0		// per sector
+#define FAKE_FLASH_READ_MA 15.0
+#define FAKE_FLASH_PROGRAM_MA 20.0
+#define FAKE_FLASH_ERASE_MA 20.0
+#define FAKE_FLASH_VOLTS 3.3
+
+typedef struct
+{
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long erases;
+    unsigned long long read_bytes;
+    unsigned long long written_bytes;
+    unsigned long lost_bits;		// 1 bits written over 0 bits, which NOR flash can't do,
+					// in bytes other than the 0xFF padding
+    unsigned long refused;		// calls not on whole words, which the SDK fails
+    double busy_us;			// the time the flash would have taken
+    double energy_uj;
+} fake_flash_stats_t;
+
+extern uint8_t fake_flash[FAKE_FLASH_SIZE];
+extern fake_flash_stats_t fake_flash_stats;
+
+/* Erases the whole flash, to all 1 bits, and clears fake_flash_stats. */
+void fake_flash_reset();
+
+#endif
@@ -0,0 +1,310 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Runs SPIFFS as the ESP8266 does, with the flash access in fs_hal.c and the configuration in
+   fs.h, on the RAM flash in fake_flash.c, and reports what each kind of operation costs: how
+   many the host does per second, and the flash reads, writes, erases, bus time and energy of
+   each, which is what matters on the device. Everything read back is checked, and the file
+   system too at the end, and it exits with 1 if anything is wrong.
+
+   spiffs_bench [scale] runs 1/scale of the operations.
+*/
+
+#include <time.h>
+#include "esp_common.h"
+#include "spiffs/spiffs.h"
+#include "spiffs/fs.h"
+#include "fake_flash.h"
+
+#define FILES 64			// small files for create, open and remove
+#define FILE_SIZE 256
+#define RECORD_SIZE 64			// the log is appended, read and seeked in records
+#define LOG_RECORDS 8192		// 512 KB
+#define SEEKS 2048
+#define GC_FILE_SIZE 16384		// files the file system is filled with, to rewrite
+#define GC_FILL_PERCENT 50		// of live pages; the appends leave as many again deleted
+#define GC_REWRITES 64
+
+static spiffs fs;
+static u8_t work_buf[LOG_PAGE_SIZE * 2];
+static u8_t fd_buf[FS_FILE_DESCRIPTOR_SIZE];
+static u8_t cache_buf[FS_CACHE_SIZE];
+
+static int scale = 1;
+static int failures;
+
+#define CHECK( condition ) \
+    if( !( condition ) ) { \
+        fprintf( stderr, "FAILED: %s:%d: %s (%d)\n", __FILE__, __LINE__, #condition, SPIFFS_errno( &fs ) ); \
+        failures++; \
+    }
+
+/* The same configuration as fs_task() in fs.c. */
+static void mount()
+{
+    spiffs_config cfg;
+    fake_flash_reset();
+    memset( &cfg, 0, sizeof( cfg ) );
+    cfg.phys_size = SPI_FLASH_PHYS_SIZE;
+    cfg.phys_addr = SPI_FLASH_START_ADDR;
+    cfg.phys_erase_block = SPI_FLASH_SEC_SIZE;
+    cfg.log_block_size = SPI_FLASH_SEC_SIZE;
+    cfg.log_page_size = LOG_PAGE_SIZE;
+    cfg.hal_read_f = fs_hal_read;
+    cfg.hal_write_f = fs_hal_write;
+    cfg.hal_erase_f = fs_hal_erase;
+    CHECK( SPIFFS_mount( &fs, &cfg, work_buf, fd_buf, sizeof( fd_buf ), cache_buf, sizeof( cache_buf ), 0 ) == SPIFFS_OK );
+}
+
+/* The bytes of record n, so that any record read back can be checked. */
+static void record( int n, u8_t* buffer, int size )
+{
+    int i;
+    for( i = 0; i < size; i++ ) {
+        buffer[i] = n * 31 + i;
+    }
+}
+
+/* A workload between begin() and end(), which prints its costs per operation. */
+static struct
+{
+    const char* name;
+    struct timespec start;
+    fake_flash_stats_t flash;
+    u32_t cache_hits;
+    u32_t cache_misses;
+} run;
+
+static void begin( const char* name )
+{
+    run.name = name;
+    run.flash = fake_flash_stats;
+    run.cache_hits = fs.cache_hits;
+    run.cache_misses = fs.cache_misses;
+    clock_gettime( CLOCK_MONOTONIC, &run.start );
+}
+
+static void end( int ops )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    double seconds = ( now.tv_sec - run.start.tv_sec ) + ( now.tv_nsec - run.start.tv_nsec ) / 1e9;
+    u32_t hits = fs.cache_hits - run.cache_hits;
+    u32_t lookups = hits + fs.cache_misses - run.cache_misses;
+    printf( "%-8s %6d %10.0f %9.2f %9.2f %9.4f %10.1f %10.1f %6.1f\n", run.name, ops, ops / seconds,
+            (double) ( fake_flash_stats.reads - run.flash.reads ) / ops,
+            (double) ( fake_flash_stats.writes - run.flash.writes ) / ops,
+            (double) ( fake_flash_stats.erases - run.flash.erases ) / ops,
+            ( fake_flash_stats.busy_us - run.flash.busy_us ) / ops,
+            ( fake_flash_stats.energy_uj - run.flash.energy_uj ) / ops,
+            lookups != 0 ? 100.0 * hits / lookups : 0.0 );
+}
+
+static void file_name( char* name, const char* prefix, int n )
+{
+    sprintf( name, "%s%03d", prefix, n );
+}
+
+static void create_files()
+{
+    char name[SPIFFS_OBJ_NAME_LEN];
+    u8_t buffer[FILE_SIZE];
+    int files = FILES / scale;
+    int i;
+    begin( "create" );
+    for( i = 0; i < files; i++ ) {
+        file_name( name, "f", i );
+        record( i, buffer, sizeof( buffer ) );
+        spiffs_file fd = SPIFFS_open( &fs, name, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0 );
+        CHECK( fd >= 0 );
+        CHECK( SPIFFS_write( &fs, fd, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+        SPIFFS_close( &fs, fd );
+    }
+    end( files );
+}
+
+static void open_files()
+{
+    char name[SPIFFS_OBJ_NAME_LEN];
+    int files = FILES / scale;
+    int i;
+    begin( "open" );
+    for( i = 0; i < 8 * files; i++ ) {
+        file_name( name, "f", i % files );
+        spiffs_file fd = SPIFFS_open( &fs, name, SPIFFS_RDONLY, 0 );
+        CHECK( fd >= 0 );
+        SPIFFS_close( &fs, fd );
+    }
+    end( 8 * files );
+}
+
+static void append_log()
+{
+    u8_t buffer[RECORD_SIZE];
+    int records = LOG_RECORDS / scale;
+    int i;
+    spiffs_file fd = SPIFFS_open( &fs, "log", SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0 );
+    CHECK( fd >= 0 );
+    begin( "append" );
+    for( i = 0; i < records; i++ ) {
+        record( i, buffer, sizeof( buffer ) );
+        CHECK( SPIFFS_write( &fs, fd, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+    }
+    SPIFFS_close( &fs, fd );
+    end( records );
+}
+
+static void read_log()
+{
+    u8_t buffer[RECORD_SIZE];
+    u8_t expected[RECORD_SIZE];
+    int records = LOG_RECORDS / scale;
+    int i;
+    spiffs_file fd = SPIFFS_open( &fs, "log", SPIFFS_RDONLY, 0 );
+    CHECK( fd >= 0 );
+    begin( "read" );
+    for( i = 0; i < records; i++ ) {
+        record( i, expected, sizeof( expected ) );
+        CHECK( SPIFFS_read( &fs, fd, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+        CHECK( memcmp( buffer, expected, sizeof( buffer ) ) == 0 );
+    }
+    end( records );
+    SPIFFS_close( &fs, fd );
+}
+
+static void seek_log()
+{
+    u8_t buffer[RECORD_SIZE];
+    u8_t expected[RECORD_SIZE];
+    int records = LOG_RECORDS / scale;
+    int seeks = SEEKS / scale;
+    unsigned int random = 1;
+    int i;
+    spiffs_file fd = SPIFFS_open( &fs, "log", SPIFFS_RDONLY, 0 );
+    CHECK( fd >= 0 );
+    begin( "seek" );
+    for( i = 0; i < seeks; i++ ) {
+        random = random * 1103515245 + 12345;
+        int n = ( random >> 8 ) % records;
+        record( n, expected, sizeof( expected ) );
+        CHECK( SPIFFS_lseek( &fs, fd, n * RECORD_SIZE, SPIFFS_SEEK_SET ) == n * RECORD_SIZE );
+        CHECK( SPIFFS_read( &fs, fd, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+        CHECK( memcmp( buffer, expected, sizeof( buffer ) ) == 0 );
+    }
+    end( seeks );
+    SPIFFS_close( &fs, fd );
+}
+
+/* Reads the log while appending what it reads to another file, so that reading and allocating
+   compete for the cache. */
+static void copy_log()
+{
+    u8_t buffer[RECORD_SIZE];
+    u8_t expected[RECORD_SIZE];
+    int records = LOG_RECORDS / scale;
+    int i;
+    spiffs_file in = SPIFFS_open( &fs, "log", SPIFFS_RDONLY, 0 );
+    spiffs_file out = SPIFFS_open( &fs, "copy", SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0 );
+    CHECK( in >= 0 );
+    CHECK( out >= 0 );
+    begin( "copy" );
+    for( i = 0; i < records; i++ ) {
+        record( i, expected, sizeof( expected ) );
+        CHECK( SPIFFS_read( &fs, in, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+        CHECK( memcmp( buffer, expected, sizeof( buffer ) ) == 0 );
+        CHECK( SPIFFS_write( &fs, out, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+    }
+    end( records );
+    SPIFFS_close( &fs, in );
+    SPIFFS_close( &fs, out );
+    CHECK( SPIFFS_remove( &fs, "copy" ) == SPIFFS_OK );
+}
+
+static void remove_files()
+{
+    char name[SPIFFS_OBJ_NAME_LEN];
+    int files = FILES / scale;
+    int i;
+    begin( "remove" );
+    for( i = 0; i < files; i++ ) {
+        file_name( name, "f", i );
+        CHECK( SPIFFS_remove( &fs, name ) == SPIFFS_OK );
+    }
+    end( files );
+}
+
+static void write_file( const char* name, int n, int size )
+{
+    u8_t buffer[LOG_PAGE_SIZE];
+    int written;
+    spiffs_file fd = SPIFFS_open( &fs, (char*) name, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0 );
+    CHECK( fd >= 0 );
+    for( written = 0; written < size; written += sizeof( buffer ) ) {
+        record( n + written, buffer, sizeof( buffer ) );
+        CHECK( SPIFFS_write( &fs, fd, buffer, sizeof( buffer ) ) == sizeof( buffer ) );
+    }
+    SPIFFS_close( &fs, fd );
+}
+
+/* Fills the file system, then rewrites the files, so that every rewrite has to collect garbage
+   to find free pages. */
+static void collect_garbage()
+{
+    char name[SPIFFS_OBJ_NAME_LEN];
+    u32_t total, used;
+    int files = 0;
+    int rewrites = GC_REWRITES / scale;
+    int i;
+    do {
+        file_name( name, "g", files );
+        write_file( name, files, GC_FILE_SIZE );
+        files++;
+        CHECK( SPIFFS_info( &fs, &total, &used ) == SPIFFS_OK );
+    } while( used < total / 100 * GC_FILL_PERCENT && failures == 0 );
+    u32_t gc_runs = fs.stats_gc_runs;
+    begin( "gc" );
+    for( i = 0; i < rewrites; i++ ) {
+        file_name( name, "g", i % files );
+        write_file( name, i, GC_FILE_SIZE );
+    }
+    end( rewrites );
+    CHECK( fs.stats_gc_runs > gc_runs );
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 ) {
+        scale = atoi( argv[1] );
+    }
+    mount();
+    printf( "%-8s %6s %10s %9s %9s %9s %10s %10s %6s\n", "per op", "ops", "ops/s", "reads", "writes",
+            "erases", "flash us", "flash uJ", "cache%" );
+    create_files();
+    open_files();
+    append_log();
+    read_log();
+    seek_log();
+    copy_log();
+    remove_files();
+    collect_garbage();
+    CHECK( SPIFFS_check( &fs ) == SPIFFS_OK );
+    // SPIFFS marks a page deleted by writing its flags as 0x7E over whatever flags were cleared
+    // before, so those bits are counted too.
+    printf( "%lu bits written 1 over 0 outside the padding, which stay 0, %lu calls refused\n", fake_flash_stats.lost_bits, fake_flash_stats.refused );
+    CHECK( fake_flash_stats.refused == 0 );
+    SPIFFS_unmount( &fs );
+    return failures != 0;
+}
@@ -0,0 +1,149 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Runs the ESP8266's tcp_shell.c against the fake espconn in fake_espconn.c. */
+
+#include "espconn.h"
+#include "tcp_shell.h"
+#include "fake_espconn.h"
+
+static int failures;
+
+#define CHECK( condition ) \
+    if( !( condition ) ) { \
+        fprintf( stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #condition ); \
+        failures++; \
+    }
+
+static char pattern[40000];
+
+static void reset()
+{
+    while( fake_ack() );
+    fake_wire_length = 0;
+    fake_max_in_flight = 0;
+    fake_sends = 0;
+    fake_short_sends = 0;
+    fake_refused = 0;
+    fake_delays = 0;
+}
+
+/* A long dump goes out in full packets, never more than TCP_SHELL_TX_BUFFERS in flight, and
+   the shell waits for acknowledgements instead of overwriting packets. */
+static void test_dump()
+{
+    static const int sizes[] = { 1, 7, 100, 3000, 1460, 1459 };
+    int sent = 0;
+    int i = 0;
+    reset();
+    while( sent < sizeof( pattern ) - 3000 ) {
+        int size = sizes[i++ % 6];
+        if( size == 1 ) {
+            tcp_shell_put_char( pattern[sent] );
+        } else {
+            tcp_shell_put_chars( pattern + sent, size );
+        }
+        sent += size;
+    }
+    tcp_shell_flush();
+    while( fake_ack() );
+    CHECK( fake_wire_length == sent );
+    CHECK( memcmp( fake_wire, pattern, sent ) == 0 );
+    CHECK( fake_sends == ( sent + MAX_PACKET_SIZE - 1 ) / MAX_PACKET_SIZE );
+    CHECK( fake_short_sends == 1 );
+    CHECK( fake_max_in_flight == TCP_SHELL_TX_BUFFERS );
+    CHECK( fake_delays > 0 );
+}
+
+/* A packet filled a character at a time goes out whole, and not a byte past it. */
+static void test_full_packet()
+{
+    int i;
+    reset();
+    for( i = 0; i < MAX_PACKET_SIZE; i++ ) {
+        tcp_shell_put_char( pattern[i] );
+    }
+    CHECK( fake_sends == 1 );
+    tcp_shell_flush();
+    CHECK( fake_sends == 1 );
+    while( fake_ack() );
+    CHECK( fake_wire_length == MAX_PACKET_SIZE );
+    CHECK( memcmp( fake_wire, pattern, MAX_PACKET_SIZE ) == 0 );
+}
+
+/* When espconn runs out of send buffers before the shell does, the send is retried. */
+static void test_refused()
+{
+    reset();
+    fake_window = 2;
+    tcp_shell_put_chars( pattern, 6 * MAX_PACKET_SIZE );
+    tcp_shell_flush();
+    while( fake_ack() );
+    fake_window = 64;
+    CHECK( fake_refused > 0 );
+    CHECK( fake_max_in_flight == 2 );
+    CHECK( fake_wire_length == 6 * MAX_PACKET_SIZE );
+    CHECK( memcmp( fake_wire, pattern, 6 * MAX_PACKET_SIZE ) == 0 );
+}
+
+/* Received segments come out in order, and reception is held while the ring is nearly full. */
+static void test_receive()
+{
+    char buffer[TCP_SHELL_RX_SIZE];
+    int count = 0;
+    count += tcp_shell_read_chars( buffer, sizeof( buffer ) );
+    CHECK( count == 8 && memcmp( buffer, "WELCOME\n", 8 ) == 0 );
+    fake_receive( pattern, MAX_PACKET_SIZE );
+    CHECK( !fake_held );
+    fake_receive( pattern + MAX_PACKET_SIZE, MAX_PACKET_SIZE );
+    CHECK( fake_held );
+    count = tcp_shell_read_chars( buffer, 100 );
+    CHECK( count == 100 && fake_held );
+    count += tcp_shell_read_chars( buffer + 100, sizeof( buffer ) );
+    CHECK( count == 2 * MAX_PACKET_SIZE && !fake_held );
+    CHECK( memcmp( buffer, pattern, count ) == 0 );
+    fake_receive( pattern, 3 * MAX_PACKET_SIZE / 2 );	// wraps around the ring
+    count = tcp_shell_read_chars( buffer, sizeof( buffer ) );
+    CHECK( count == 3 * MAX_PACKET_SIZE / 2 );
+    CHECK( memcmp( buffer, pattern, count ) == 0 );
+}
+
+/* Once the client has gone, output is dropped rather than waited on. */
+static void test_disconnect()
+{
+    reset();
+    tcp_shell_put_chars( pattern, MAX_PACKET_SIZE );
+    fake_disconnect();
+    CHECK( !tcp_shell_is_connected() );
+    tcp_shell_put_chars( pattern, sizeof( pattern ) );
+    CHECK( fake_delays == 0 );
+}
+
+int main()
+{
+    int i;
+    for( i = 0; i < sizeof( pattern ); i++ ) {
+        pattern[i] = 'a' + i % 26 + ( i / 26 ) % 7;
+    }
+    tcp_shell_init();
+    fake_connect();
+    test_receive();
+    test_full_packet();
+    test_dump();
+    test_refused();
+    test_disconnect();
+    return failures != 0;
+}
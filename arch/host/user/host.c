@@ -0,0 +1,1963 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* The Linux hosted counterpart of esp8266.S, in portable C.
+
+   It exists so that the interpreter hot paths can be benchmarked and regression tested
+   without flashing a device. The tutorial lives in esp8266.S and is not repeated here; this
+   file follows the same order, the same names and the same memory layout, so that the two
+   can be read side by side.
+
+   The differences are;
+
+   (1) Forth addresses are byte offsets from the system_t (see forthright.h), so all memory
+       access goes through fetch()/store() and the BYTE() macro.
+
+   (2) A codeword is not the address of machine code, but a number from the 'codeword' enum
+       below, and NEXT dispatches on it with a switch. DOCOL and DODOES are codewords too.
+       The numbers start at CODE_SPACE, which is where the flash mapped code lives on the
+       ESP8266, so that the direct threaded build (FORTHRIGHT_DTC) can tell a codeword from
+       a Forth address in the same way.
+
+   (3) There is no .rodata to put the built-in dictionary in, so forthright_start() lays it
+       down at the bottom of the data segment, and then shrinks the data segment to what is
+       left. DATA-SEGMENT-START and UNUSED therefore see the same picture as on the device.
+
+	+--------------+-----------------------------------------------------+
+	| ESP-8266 Reg | Host                                                |
+	+--------------+-----------------------------------------------------+
+	|  a8          | w, the codeword pointer                             |
+	|  a12         | sys (and mem, the same address as a byte pointer)   |
+	|  a13         | rsp                                                 |
+	|  a14         | ip                                                  |
+	|  a15         | dsp                                                 |
+	|  a7          | tos, the top of the data stack                      |
+	+--------------+-----------------------------------------------------+
+*/
+
+#include <setjmp.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "forthright.h"
+
+/* Flags - see esp8266.S */
+#define F_IMMED 0x80
+#define F_INLINE 0x40
+#define F_HIDDEN 0x20
+#define F_LENMASK 0x1f
+
+static system_t* sys;
+static uint8_t* mem;
+static jmp_buf exit_to_c;
+static const char* source_position;	// position in forthright_source while initializing
+static ucell_t cold_start;		// QUIT, without a codeword, where forthright_start() begins
+
+static inline cell_t fetch( ucell_t addr )
+{
+    cell_t value;
+    memcpy( &value, mem + addr, sizeof( cell_t ) );
+    return value;
+}
+
+static inline void store( ucell_t addr, cell_t value )
+{
+    memcpy( mem + addr, &value, sizeof( cell_t ) );
+}
+
+#define BYTE( addr ) ( mem[ (ucell_t) ( addr ) ] )
+
+/* Macros to deal with the return stack. */
+#define PUSHRSP( value ) ( rsp -= 4, store( rsp, value ) )
+#define POPRSP() ( rsp += 4, fetch( rsp - 4 ) )
+
+/* Macros to deal with the data stack. The top of the stack is cached in tos (a7), and dsp
+   points to the second element, see "PARAMETER (DATA) STACK" in esp8266.S. */
+#define PUSHDATASTACK( value ) ( dsp -= 4, store( dsp, tos ), tos = ( value ) )
+#define POPDATASTACK() ( popped = tos, tos = fetch( dsp ), dsp += 4, popped )
+#define READTOSX() tos
+#define WRITETOSX( value ) ( tos = ( value ) )
+#define READTOSY() fetch( dsp )
+#define WRITETOSY( value ) store( dsp, value )
+#define READTOSZ() fetch( dsp + 4 )
+#define WRITETOSZ( value ) store( dsp + 4, value )
+#define READTOST() fetch( dsp + 8 )
+#define WRITETOST( value ) store( dsp + 8, value )
+
+/*
+	BUILT-IN WORDS ----------------------------------------------------------------------
+
+	The dictionary, in the same order as esp8266.S. Each entry is one of;
+
+	defcode( name, flags, label )		a primitive, implemented by 'case code_label:' in NEXT
+	defconst( name, label, value )		a primitive that pushes a constant
+	defword( name, flags, label )		a colon definition, with its threaded code in body_label[]
+*/
+#define DICTIONARY \
+	defcode( "drop", 0, DROP ) \
+	defcode( "swap", 0, SWAP ) \
+	defcode( "dup", 0, DUP ) \
+	defcode( "over", 0, OVER ) \
+	defcode( "rot", 0, ROT ) \
+	defcode( "-rot", 0, NROT ) \
+	defcode( "2drop", 0, TWODROP ) \
+	defcode( "2dup", 0, TWODUP ) \
+	defcode( "2swap", 0, TWOSWAP ) \
+	defcode( "?dup", 0, QDUP ) \
+	defcode( "1+", 0, INCR ) \
+	defcode( "1-", 0, DECR ) \
+	defcode( "4+", 0, INCR4 ) \
+	defcode( "4-", 0, DECR4 ) \
+	defcode( "+", 0, ADD ) \
+	defcode( "-", 0, SUB ) \
+	defcode( "*", 0, MUL ) \
+	defcode( "u/mod", 0, UDIVMOD ) \
+	defcode( "/", 0, DIV ) \
+	defcode( "mod", 0, MOD ) \
+	defcode( "=", 0, EQU ) \
+	defcode( "<>", 0, NEQU ) \
+	defcode( "<", 0, LT ) \
+	defcode( ">", 0, GT ) \
+	defcode( "<=", 0, LE ) \
+	defcode( ">=", 0, GE ) \
+	defcode( "0=", 0, ZEQU ) \
+	defcode( "0<>", 0, ZNEQU ) \
+	defcode( "0<", 0, ZLT ) \
+	defcode( "0>", 0, ZGT ) \
+	defcode( "0<=", 0, ZLE ) \
+	defcode( "0>=", 0, ZGE ) \
+	defcode( "and", 0, AND ) \
+	defcode( "or", 0, OR ) \
+	defcode( "xor", 0, XOR ) \
+	defcode( "invert", 0, INVERT ) \
+	defcode( "lshift", 0, SHIFTL ) \
+	defcode( "rshift", 0, SHIFTR ) \
+	defcode( "rshift_a", 0, SHIFTRA ) \
+	defcode( "exit", 0, EXIT ) \
+	defcode( "lit", 0, LIT ) \
+	defcode( "!", 0, STORE ) \
+	defcode( "@", 0, FETCH ) \
+	defcode( "+!", 0, ADDSTORE ) \
+	defcode( "-!", 0, SUBSTORE ) \
+	defcode( "c!", 0, STOREBYTE ) \
+	defcode( "c@", 0, FETCHBYTE ) \
+	defcode( "c@c!", 0, CCOPY ) \
+	defcode( "cmove", 0, CMOVE ) \
+	defcode( "state", 0, STATE ) \
+	defcode( "dp", 0, DP ) \
+	defcode( "data-segment-start", 0, DS0 ) \
+	defcode( "data-segment-size", 0, DS_SIZE ) \
+	defcode( "data-segment-end", 0, DS_END ) \
+	defcode( "segment-chunk", 0, SEGMENT_CHUNK ) \
+	defcode( "latest", 0, LATEST ) \
+	defcode( "s0", 0, S0 ) \
+	defcode( "base", 0, BASE ) \
+	defcode( "docol", 0, __DOCOL ) \
+	defconst( "version", VERSION, FORTHRIGHT_VERSION_MAJOR ) \
+	defconst( "f_immed", __F_IMMED, F_IMMED ) \
+	defconst( "f_hidden", __F_HIDDEN, F_HIDDEN ) \
+	defconst( "f_lenmask", __F_LENMASK, F_LENMASK ) \
+	defcode( "r0", 0, RZ ) \
+	defcode( ">r", 0, TOR ) \
+	defcode( "r>", 0, FROMR ) \
+	defcode( "rsp@", 0, RSPFETCH ) \
+	defcode( "rsp!", 0, RSPSTORE ) \
+	defcode( "rdrop", 0, RDROP ) \
+	defcode( "dsp@", 0, DSPFETCH ) \
+	defcode( "dsp!", 0, DSPSTORE ) \
+	defcode( "key", 0, KEY ) \
+	defcode( "emit", 0, EMIT ) \
+	defcode( "word", 0, WORD ) \
+	defcode( "number", 0, NUMBER ) \
+	defcode( "(find)", 0, PAREN_FIND ) \
+	defcode( ">cfa", 0, TCFA ) \
+	defword( ">dfa", 0, TDFA ) \
+	defcode( "header,", 0, HEADER_COMMA ) \
+	defcode( ",", 0, COMMA ) \
+	defcode( "compile,", 0, COMPILE_COMMA ) \
+	defcode( "allot", 0, ALLOT ) \
+	defcode( "[", F_IMMED, LBRAC ) \
+	defcode( "]", 0, RBRAC ) \
+	defword( ":", 0, COLON ) \
+	defword( ";", F_IMMED, SEMICOLON ) \
+	defcode( "immediate", F_IMMED, IMMEDIATE ) \
+	defcode( "inline", F_IMMED, INLINE ) \
+	defcode( "(inline)", 0, PAREN_INLINE ) \
+	defcode( "hidden", 0, HIDDEN ) \
+	defword( "hide", 0, HIDE ) \
+	defcode( "[']", 0, BRACKET_TICK ) \
+	defcode( "branch", 0, BRANCH ) \
+	defcode( "0branch", 0, ZBRANCH ) \
+	defcode( "lit+", 0, LITADD ) \
+	defcode( "@+", 0, FETCHADD ) \
+	defcode( "=0branch", 0, EQU_ZBRANCH ) \
+	defcode( "0=0branch", 0, ZEQU_ZBRANCH ) \
+	defcode( "?dup0branch", 0, QDUP_ZBRANCH ) \
+	defcode( "litstring", 0, LITSTRING ) \
+	defcode( "tell", 0, TELL ) \
+	defcode( "flush", 0, FLUSH ) \
+	defcode( "echo", 0, ECHO ) \
+	defconst( "dodoes", __DODOES, DODOES ) \
+	defword( "quit", 0, QUIT ) \
+	defcode( "interpret", 0, INTERPRET ) \
+	defcode( "2*", 0, TWOMUL ) \
+	defcode( "2/", 0, TWODIV ) \
+	defcode( "(do)", 0, PAREN_DO ) \
+	defcode( "(loop)", 0, PAREN_LOOP ) \
+	defcode( "(+loop)", 0, PAREN_PLUS_LOOP ) \
+	defcode( "unloop", 0, UNLOOP ) \
+	defcode( "i", 0, I ) \
+	defcode( "j", 0, J ) \
+	defcode( "fseek", 0, LSEEK ) \
+	defcode( "fread", 0, READ ) \
+	defcode( "fwrite", 0, FWRITE ) \
+	defcode( "fopen", 0, FOPEN ) \
+	defcode( "fclose", 0, FCLOSE ) \
+	defcode( "fdirlist", 0, FDIRLIST ) \
+	defcode( "save-image", 0, SAVE_IMAGE ) \
+	defcode( "load-image", 0, LOAD_IMAGE ) \
+	defcode( "rom{", 0, ROM_BEGIN ) \
+	defcode( "}rom", 0, ROM_END ) \
+	defcode( "allocate", 0, ALLOCATE ) \
+	defcode( "free", 0, FREE ) \
+	defcode( "resize", 0, RESIZE ) \
+	defcode( "heap-stats", 0, HEAP_STATS ) \
+	defcode( "mark-arena", 0, MARK_ARENA ) \
+	defcode( "release-arena", 0, RELEASE_ARENA ) \
+	defcode( "char", 0, CHAR ) \
+	defcode( "init-done", 0, INITIALIZEDONE ) \
+	defcode( "execute", 0, EXECUTE ) \
+	defcode( "rdtsc", 0, RDTSC )
+
+/* The codewords. Forth addresses are always below CODE_SPACE. */
+#define CODE_SPACE 0x40000000
+
+enum codeword
+{
+    DOCOL = CODE_SPACE,
+    DODOES,
+#define defcode( name, flags, label ) code_##label,
+#define defconst( name, label, value ) code_##label,
+#define defword( name, flags, label )
+    DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+};
+
+/* One label per dictionary entry, used in the threaded code of the defwords. */
+enum label
+{
+#define defcode( name, flags, label ) label,
+#define defconst( name, label, value ) label,
+#define defword( name, flags, label ) label,
+    DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+    LABEL_COUNT
+};
+
+/* Threaded code of the defwords. Cells following BRANCH are offsets, and cells in CODE_SPACE
+   are codewords, and both are taken literally. All other cells are labels, and are replaced by
+   the codeword address of that label. */
+#ifdef FORTHRIGHT_DTC
+#define COMPILED_EXIT code_EXIT		// what ';' compiles, the same as INTERPRET would
+#define COMPILED_EXIT_CELL code_EXIT
+#else
+#define COMPILED_EXIT EXIT
+#define COMPILED_EXIT_CELL cfa[EXIT]
+#endif
+
+static const cell_t body_TDFA[] = { TCFA, INCR4, EXIT };
+static const cell_t body_COLON[] = { WORD, HEADER_COMMA, LIT, DOCOL, COMMA, LATEST, FETCH, HIDDEN, RBRAC, EXIT };
+static const cell_t body_SEMICOLON[] = { LIT, COMPILED_EXIT, COMMA, LATEST, FETCH, HIDDEN, LBRAC, EXIT };
+static const cell_t body_HIDE[] = { WORD, PAREN_FIND, HIDDEN, EXIT };
+static const cell_t body_QUIT[] = { RZ, RSPSTORE, INTERPRET, BRANCH, -8 };
+
+static const struct
+{
+    const char* name;
+    int flags;
+    cell_t codeword;
+    const cell_t* body;
+    int body_size;
+} dictionary[] =
+{
+#define defcode( name, flags, label ) { name, flags, code_##label, 0, 0 },
+#define defconst( name, label, value ) { name, 0, code_##label, 0, 0 },
+#define defword( name, flags, label ) { name, flags, DOCOL, body_##label, sizeof( body_##label ) / sizeof( cell_t ) },
+    DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+};
+
+static ucell_t cfa[LABEL_COUNT];	// codeword address of each label, once laid down
+static ucell_t nfa[LABEL_COUNT];	// and the address of its header
+static ucell_t builtin_latest;		// the last header of the built-in dictionary
+
+/* The superinstructions, see _COMPILE_COMMA. Chosen with 'make profile'. */
+static const int superinstructions[][3] =
+{
+    { LIT, ADD, LITADD },
+    { FETCH, ADD, FETCHADD },
+    { OVER, OVER, TWODUP },
+    { FROMR, DROP, RDROP },
+    { EQU, ZBRANCH, EQU_ZBRANCH },
+    { ZEQU, ZBRANCH, ZEQU_ZBRANCH },
+    { QDUP, ZBRANCH, QDUP_ZBRANCH },
+};
+
+/* Lays down the built-in dictionary at DP, and returns the address of the last header. */
+static ucell_t lay_down_dictionary()
+{
+    ucell_t previous_word_link = 0;
+    ucell_t body[LABEL_COUNT];
+    int label;
+
+    for( label = 0; label < LABEL_COUNT; label++ ) {
+        ucell_t header = sys->dp;
+        int length = strlen( dictionary[label].name );
+        nfa[label] = header;
+        store( header, previous_word_link );			// link
+        previous_word_link = header;
+        BYTE( header + 4 ) = dictionary[label].flags + length;	// flags + length byte
+        memcpy( mem + header + 5, dictionary[label].name, length );	// the name
+        cfa[label] = ( header + length + 8 ) & ~3;		// padding to next 4 byte boundary
+        memset( mem + header + 5 + length, 0, cfa[label] - header - 5 - length );
+        store( cfa[label], dictionary[label].codeword );	// codeword
+        body[label] = cfa[label] + 4;
+        sys->dp = body[label] + dictionary[label].body_size * 4;
+    }
+
+    // Second pass, as defwords may refer to labels further down, like ':' does to 'hidden'.
+    for( label = 0; label < LABEL_COUNT; label++ ) {
+        int i;
+        for( i = 0; i < dictionary[label].body_size; i++ ) {
+            cell_t cell = dictionary[label].body[i];
+            if( cell >= CODE_SPACE || ( i > 0 && dictionary[label].body[i-1] == BRANCH ) ) {
+                store( body[label] + i * 4, cell );
+            } else {
+                store( body[label] + i * 4, cfa[cell] );
+            }
+        }
+    }
+    return previous_word_link;
+}
+
+/*
+	INPUT AND OUTPUT ----------------------------------------------------------------------
+*/
+static int _KEY()
+{
+    while( sys->currkey >= sys->bufftop ) {
+        // Out of input;
+        if( sys->initializing && *source_position != 0 ) {
+            // While initializing, the input is forthright.f, compiled into the program.
+            int count = strnlen( source_position, sys->input_buffer_size );
+            memcpy( mem + sys->input_buffer, source_position, count );
+            source_position += count;
+            sys->currkey = sys->input_buffer;
+            sys->bufftop = sys->input_buffer + count;
+        } else {
+            int count = forthright_readChars( (char*) mem + sys->input_buffer, sys->input_buffer_size );
+            if( count < 0 ) {
+                longjmp( exit_to_c, 1 );			// abort and exit Forth
+            }
+            sys->currkey = sys->input_buffer;
+            sys->bufftop = sys->input_buffer + count;
+        }
+    }
+    int ch = BYTE( sys->currkey++ );			// get next key from input buffer
+    if( sys->echo ) {
+        forthright_echo_char( ch );
+    }
+    return ch;
+}
+
+/* Echoes the input from currkey up to key, if echo is on, and moves currkey there. */
+static void _CONSUME( ucell_t key )
+{
+    if( sys->echo ) {
+        ucell_t p;
+        for( p = sys->currkey; p < key; p++ ) {
+            forthright_echo_char( BYTE( p ) );
+        }
+    }
+    sys->currkey = key;
+}
+
+/* Reads the next word of input into the word buffer. Returns its address, and the length
+   in *length. Same control flow as _WORD in esp8266.S. */
+static ucell_t _WORD( cell_t* length )
+{
+    ucell_t key = sys->currkey;
+    ucell_t top = sys->bufftop;
+    ucell_t end;
+    cell_t size = sys->word_buffer_size;
+    int ch;
+
+    /* Fast path: scan the input buffer directly for the word, and copy it in one go. Skip
+       blanks and \ comments, unless the comment runs past the end of the buffer. */
+    for( ;; ) {
+        while( key < top && BYTE( key ) <= ' ' ) {
+            key++;
+        }
+        if( key < top && BYTE( key ) == '\\' ) {
+            char* eol = memchr( mem + key, '\n', top - key );
+            if( eol != NULL ) {
+                key = (char*) eol - (char*) mem + 1;
+                continue;
+            }
+        }
+        break;
+    }
+    end = key;
+    while( end < top && end - key < size && BYTE( end ) > ' ' ) {
+        end++;
+    }
+    if( key < top && BYTE( key ) != '\\' && ( end < top || end - key == size ) ) {
+        *length = end - key;
+        memcpy( mem + sys->word_buffer, mem + key, *length );
+        sys->word_buffer_ptr = sys->word_buffer + *length;
+        sys->word_buffer_counter = size - *length;
+        _CONSUME( *length < size ? end + 1 : end );	// with the delimiter, unless the buffer is full
+        return sys->word_buffer;
+    }
+
+    /* Slow path, at the end of the input buffer: a key at a time, through _KEY. */
+    _CONSUME( key );
+    for( ;; ) {
+        ch = _KEY();
+        if( ch == '\\' ) {
+            while( _KEY() != '\n' );			// skip the comment to end of the line
+            continue;
+        }
+        if( ch > ' ' ) {
+            break;
+        }
+    }
+
+    /* Search for the end of the word, storing chars as we go. */
+    sys->word_buffer_ptr = sys->word_buffer;
+    sys->word_buffer_counter = sys->word_buffer_size;
+    do {
+        BYTE( sys->word_buffer_ptr++ ) = ch;
+        if( --sys->word_buffer_counter == 0 ) {
+            break;					// Ran out of word buffer space.
+        }
+        ch = _KEY();
+    } while( ch > ' ' );
+
+    *length = sys->word_buffer_ptr - sys->word_buffer;
+    return sys->word_buffer;
+}
+
+/* Parses a string to a integer number. Returns the number, and the count of unparsed characters
+   in *unparsed, which should be 0 for success. Same control flow as _NUMBER in esp8266.S. */
+static cell_t _NUMBER( ucell_t addr, cell_t length, cell_t* unparsed )
+{
+    ucell_t number = 0;
+    int negative = 0;
+    cell_t base = sys->base;
+    cell_t digit;
+
+    if( length <= 0 ) {
+        goto error;
+    }
+    digit = BYTE( addr++ );
+    if( digit == '-' ) {
+        negative = 1;
+        if( --length == 0 ) {
+            goto error;
+        }
+        digit = BYTE( addr++ );
+    }
+    for( ;; ) {
+        // Convert 0-9, A-Z to a number 0-35.
+        digit -= '0';
+        if( digit < 0 ) {
+            goto error;
+        }
+        if( digit >= 10 ) {
+            digit -= 17;
+            if( digit < 0 ) {
+                goto error;
+            }
+            digit += 10;
+        }
+        if( digit >= base ) {
+            goto error;
+        }
+        number += digit;
+        if( --length == 0 ) {
+            break;
+        }
+        number *= base;
+        digit = BYTE( addr++ );
+    }
+    *unparsed = 0;
+    return negative ? -number : number;
+
+error:
+    *unparsed = length;
+    return 0;
+}
+
+/*
+	DICTIONARY LOOK UPS ----------------------------------------------------------------------
+
+	See esp8266.S for the dictionary index, and for comparing names a cell at a time.
+*/
+
+/* Copies the name to find_key as it is in a header; the length byte, the characters and zero
+   padding to a whole number of cells. Returns the number of cells. */
+static cell_t _FIND_KEY( ucell_t addr, cell_t length )
+{
+    cell_t cells = ( length + 4 ) >> 2;
+    memset( mem + sys->find_key, 0, cells * 4 );
+    BYTE( sys->find_key ) = length;
+    memmove( mem + sys->find_key + 1, mem + addr, length );
+    return cells;
+}
+
+/* A mask for the first cell of a name, which keeps the bits 'flags' of the length byte. */
+static cell_t _FIRST_CELL_MASK( uint8_t flags )
+{
+    uint8_t bytes[4] = { flags, 0xff, 0xff, 0xff };
+    cell_t mask;
+    memcpy( &mask, bytes, sizeof( cell_t ) );
+    return mask;
+}
+
+/* Compares the name in the header with find_key. The first cell holds the length byte, so when it
+   is equal, so is the number of cells. */
+static int _SAME_NAME( ucell_t header, cell_t cells, cell_t first_cell_mask )
+{
+    ucell_t key = sys->find_key;
+    if( ( fetch( header + 4 ) & first_cell_mask ) != fetch( key ) ) {
+        return 0;
+    }
+    while( --cells > 0 ) {
+        header += 4;
+        key += 4;
+        if( fetch( header + 4 ) != fetch( key ) ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static ucell_t _FIND_FROM( ucell_t header, cell_t cells )
+{
+    // F_HIDDEN is part of the compare, so by a bit of trickery a hidden word won't match
+    // (the length will appear to be wrong).
+    cell_t mask = _FIRST_CELL_MASK( F_HIDDEN | F_LENMASK );
+    for( ; header != 0; header = fetch( header ) ) {
+        if( _SAME_NAME( header, cells, mask ) ) {
+            return header;
+        }
+    }
+    return 0;
+}
+
+static ucell_t _HASH( cell_t cells )
+{
+    ucell_t key = sys->find_key;
+    ucell_t hash = 5381;
+    while( cells-- > 0 ) {
+        hash = ( hash * 33 ) ^ fetch( key );
+        key += 4;
+    }
+    hash ^= hash >> 16;		// the slot is taken from the low bits
+    hash ^= hash >> 8;
+    return hash;
+}
+
+/* The slot that holds the name in find_key, or else the empty slot where it would go. */
+static ucell_t _INDEX_SLOT( cell_t cells )
+{
+    cell_t mask = _FIRST_CELL_MASK( F_LENMASK );	// hidden or not, it is the same name
+    ucell_t slots = sys->dictionary_index_size - 1;
+    ucell_t i = _HASH( cells ) & slots;
+    for( ;; i = ( i + 1 ) & slots ) {
+        ucell_t slot = sys->dictionary_index + i * 4;
+        ucell_t header = fetch( slot );
+        if( header == 0 || _SAME_NAME( header, cells, mask ) ) {
+            return slot;
+        }
+    }
+}
+
+/* Indexes the header. A newer one replaces an indexed word of the same name, an older one doesn't. */
+static void _INDEX_ADD( ucell_t header, int newer )
+{
+    cell_t cells = _FIND_KEY( header + 5, BYTE( header + 4 ) & F_LENMASK );
+    ucell_t slot = _INDEX_SLOT( cells );
+    if( fetch( slot ) != 0 ) {
+        if( newer ) {
+            store( slot, header );
+        }
+        return;
+    }
+    if( ( sys->dictionary_index_used + 1 ) * 4 > sys->dictionary_index_size * 3 ) {
+        sys->dictionary_index_used = sys->dictionary_index_size;	// full, the index is incomplete
+        return;
+    }
+    sys->dictionary_index_used++;
+    store( slot, header );
+}
+
+static void _REINDEX()
+{
+    ucell_t header;
+    memset( mem + sys->dictionary_index, 0, sys->dictionary_index_size * 4 );
+    sys->dictionary_index_used = 0;
+    for( header = sys->latest; header != 0; header = fetch( header ) ) {
+        _INDEX_ADD( header, 0 );
+    }
+    sys->dictionary_indexed = sys->latest;
+}
+
+/* Called by HEADER, for the header it just made the LATEST. */
+static void _INDEX_HEADER( ucell_t header )
+{
+    if( sys->dictionary_indexed == fetch( header ) ) {
+        _INDEX_ADD( header, 1 );
+        sys->dictionary_indexed = header;
+    } else {
+        sys->dictionary_indexed = 0;	// LATEST was changed behind our back, so rebuild
+    }
+}
+
+static ucell_t _LOOKUP( ucell_t addr, cell_t length )
+{
+    if( length > F_LENMASK ) {
+        return 0;			// longer than any name
+    }
+    if( sys->dictionary_indexed != sys->latest ) {
+        _REINDEX();
+    }
+    cell_t cells = _FIND_KEY( addr, length );
+    ucell_t header = fetch( _INDEX_SLOT( cells ) );
+    if( header == 0 ) {
+        if( sys->dictionary_index_used < sys->dictionary_index_size ) {
+            return 0;
+        }
+        return _FIND_FROM( sys->latest, cells );
+    }
+    if( BYTE( header + 4 ) & F_HIDDEN ) {
+        return _FIND_FROM( fetch( header ), cells );	// an earlier definition, if any
+    }
+    return header;
+}
+
+#ifdef FORTHRIGHT_CHECK_FIND
+/* The plain search, a byte at a time through the whole list, that _LOOKUP must agree with. */
+static ucell_t _FIND_BYTES( ucell_t addr, cell_t length )
+{
+    ucell_t header;
+    for( header = sys->latest; header != 0; header = fetch( header ) ) {
+        if( ( BYTE( header + 4 ) & ( F_HIDDEN | F_LENMASK ) ) != length ) {
+            continue;
+        }
+        cell_t i;
+        for( i = 0; i < length; i++ ) {
+            if( BYTE( header + 5 + i ) != BYTE( addr + i ) ) {
+                break;
+            }
+        }
+        if( i == length ) {
+            return header;
+        }
+    }
+    return 0;
+}
+#endif
+
+static ucell_t _FIND( ucell_t addr, cell_t length )
+{
+    ucell_t header = _LOOKUP( addr, length );
+#ifdef FORTHRIGHT_CHECK_FIND
+    ucell_t expected = _FIND_BYTES( addr, length );
+    if( header != expected ) {
+        fprintf( stderr, "(find) %.*s gave %u, but a byte at a time gives %u\n", length, mem + addr, header, expected );
+        exit( 1 );
+    }
+#endif
+    return header;
+}
+
+static ucell_t _TCFA( ucell_t header )
+{
+    return ( header + 4 + ( BYTE( header + 4 ) & F_LENMASK ) + 4 ) & ~3;
+}
+
+static void _COMMA( cell_t value )
+{
+    store( sys->dp, value );
+    sys->dp += 4;
+}
+
+/* Whether DP can move on by bytes, and stay in the segment that it is in. Only HEADER, chains
+   another segment, as what a definition lays down after its header has to stay together. */
+static int _ROOM( cell_t bytes )
+{
+    cell_t end = sys->dp + bytes;
+    if( sys->dp < sys->segment_start || end < sys->segment_start || end > sys->segment_end ) {
+        forthright_find_segment( sys );		// DP may have been moved, by FORGET say
+    }
+    end = sys->dp + bytes;
+    return sys->dp >= sys->segment_start && end >= sys->segment_start && end <= sys->segment_end;
+}
+
+/* Marks the cell at addr as holding an address, if it is in the ROM{ buffer, for rom_commit() to
+   move along. The bit map is after the buffer, a bit per cell. See ROM{ in esp8266.S. */
+static void _RELOCATABLE( ucell_t addr )
+{
+    ucell_t offset = addr - sys->rom_staging;
+    if( sys->rom_staging != 0 && offset < ROM_SECTOR_SIZE ) {
+        BYTE( sys->rom_staging + ROM_SECTOR_SIZE + offset / 32 ) |= 1 << ( offset / 4 % 8 );
+    }
+}
+
+static int _IS_RELOCATABLE( ucell_t addr )
+{
+    ucell_t offset = addr - sys->rom_staging;
+    return sys->rom_staging != 0 && offset < ROM_SECTOR_SIZE
+        && ( BYTE( sys->rom_staging + ROM_SECTOR_SIZE + offset / 32 ) & ( 1 << ( offset / 4 % 8 ) ) );
+}
+
+/* The cell that is compiled for xt, which for a primitive in the direct threaded build is its
+   codeword, and otherwise xt itself. ['] already gives the codeword for those. */
+static ucell_t _COMPILED( ucell_t xt )
+{
+#ifdef FORTHRIGHT_DTC
+    if( xt < CODE_SPACE && fetch( xt ) != DOCOL && fetch( xt ) != DODOES ) {
+        return fetch( xt );
+    }
+#endif
+    return xt;
+}
+
+/* Appends xt to the current definition, or fuses it with the previous instruction into a
+   superinstruction. peephole_at is the previous instruction, and peephole_end where the
+   definition ended after it (and its inline argument, if any). If anything else was compiled
+   since, DP has moved, and if DP has been read (for a branch target), DP clears peephole_at. */
+static void _COMPILE_COMMA( ucell_t xt )
+{
+    xt = _COMPILED( xt );
+    if( sys->peephole_at != 0 && sys->peephole_end == sys->dp ) {
+        ucell_t previous = fetch( sys->peephole_at );
+        unsigned int i;
+        if( previous == _COMPILED( cfa[BRACKET_TICK] ) ) {
+            sys->peephole_at = 0;	// xt is the argument of ['], not an instruction
+            _RELOCATABLE( sys->dp );
+            _COMMA( xt );
+            return;
+        }
+        for( i = 0; i < sizeof( superinstructions ) / sizeof( superinstructions[0] ); i++ ) {
+            if( previous == _COMPILED( cfa[superinstructions[i][0]] ) && xt == _COMPILED( cfa[superinstructions[i][1]] ) ) {
+                store( sys->peephole_at, _COMPILED( cfa[superinstructions[i][2]] ) );
+                return;
+            }
+        }
+    }
+    sys->peephole_at = sys->dp;
+    _RELOCATABLE( sys->dp );
+    _COMMA( xt );
+    sys->peephole_end = sys->dp;
+}
+
+/* The size of the threaded code that _INLINE appends for the Forth word at cfa. */
+static cell_t _INLINE_SIZE( ucell_t cfa_of_word )
+{
+    ucell_t cell;
+    for( cell = cfa_of_word + 4; fetch( cell ) != COMPILED_EXIT_CELL; cell += 4 ) {
+    }
+    return cell - ( cfa_of_word + 4 );
+}
+
+/* Appends the threaded code of the Forth word at cfa, up to but not including its EXIT. */
+static void _INLINE( ucell_t cfa_of_word )
+{
+    ucell_t cell;
+    for( cell = cfa_of_word + 4; fetch( cell ) != COMPILED_EXIT_CELL; cell += 4 ) {
+        if( _IS_RELOCATABLE( cell ) ) {
+            _RELOCATABLE( sys->dp );
+        }
+        _COMMA( fetch( cell ) );
+    }
+}
+
+static void print_text( const char* text )
+{
+    forthright_putChars( (char*) text, strlen( text ) );
+}
+
+#ifdef FORTHRIGHT_PROFILE
+/*
+	PROFILING ----------------------------------------------------------------------
+
+	The profiling build counts how often each pair of words is executed back to back, to find
+	which sequences are worth a superinstruction. The pairs are printed to stderr at the end of
+	input, most frequent first, as "count first second". 'make profile' sums them over several
+	runs.
+
+	A pair is only counted when the first word continues with the next cell in the same thread,
+	i.e. not when it is a Forth word (DOCOL, DODOES) or leaves the thread (EXIT, BRANCH, ...).
+*/
+#define PROFILE_PAIRS 4096		// power of 2
+
+static struct pair
+{
+    ucell_t first;
+    ucell_t second;
+    unsigned long count;
+} pairs[PROFILE_PAIRS];
+
+static ucell_t profile_previous;		// the previous xt, 0 when not sequential
+
+static void profile( ucell_t xt, cell_t codeword )
+{
+    if( profile_previous != 0 ) {
+        unsigned int i = ( profile_previous * 31 + xt ) & ( PROFILE_PAIRS - 1 );
+        while( pairs[i].count != 0 && ( pairs[i].first != profile_previous || pairs[i].second != xt ) ) {
+            i = ( i + 1 ) & ( PROFILE_PAIRS - 1 );
+        }
+        pairs[i].first = profile_previous;
+        pairs[i].second = xt;
+        pairs[i].count++;
+    }
+    switch( codeword - CODE_SPACE ) {
+    case DOCOL - CODE_SPACE:
+    case DODOES - CODE_SPACE:
+    case code_EXIT - CODE_SPACE:
+    case code_BRANCH - CODE_SPACE:
+    case code_ZBRANCH - CODE_SPACE:
+    case code_EQU_ZBRANCH - CODE_SPACE:
+    case code_ZEQU_ZBRANCH - CODE_SPACE:
+    case code_QDUP_ZBRANCH - CODE_SPACE:
+    case code_EXECUTE - CODE_SPACE:
+    case code_INTERPRET - CODE_SPACE:
+        profile_previous = 0;
+        break;
+    default:
+        profile_previous = xt;
+    }
+}
+
+static int by_count( const void* a, const void* b )
+{
+    unsigned long count_a = ( (const struct pair*) a )->count;
+    unsigned long count_b = ( (const struct pair*) b )->count;
+    return count_a < count_b ? 1 : count_a > count_b ? -1 : 0;
+}
+
+/* Prints the name of the word with the given xt, which is either its cfa or, direct threaded,
+   its codeword. */
+static void print_name( ucell_t xt )
+{
+    ucell_t header;
+    for( header = sys->latest; header != 0; header = fetch( header ) ) {
+        if( _TCFA( header ) == xt || fetch( _TCFA( header ) ) == xt ) {
+            fprintf( stderr, " %.*s", BYTE( header + 4 ) & F_LENMASK, mem + header + 5 );
+            return;
+        }
+    }
+    fprintf( stderr, " %u", xt );
+}
+
+static void print_profile()
+{
+    int i;
+    qsort( pairs, PROFILE_PAIRS, sizeof( struct pair ), by_count );
+    for( i = 0; i < PROFILE_PAIRS && pairs[i].count != 0; i++ ) {
+        fprintf( stderr, "%10lu", pairs[i].count );
+        print_name( pairs[i].first );
+        print_name( pairs[i].second );
+        fprintf( stderr, "\n" );
+    }
+}
+#endif
+
+#ifdef FORTHRIGHT_IMAGE
+/*
+	ROM IMAGE ----------------------------------------------------------------------
+
+	The ESP8266 can boot with the dictionary that forthright.f compiles already in place, instead of
+	compiling it at every boot. forthright_write_image() prints that dictionary as gas source, which
+	esp8266.S includes with FORTHRIGHT_ROM_IMAGE defined.
+
+	The host addresses are not the device's, so each cell must be written as what it refers to. To
+	tell addresses from numbers, forthright.f is compiled twice, with the data segment moved up the
+	second time (see forthright_image() in forthright.c). A cell that moved as much is an address,
+	either into the image itself or of a built-in word. A cell that didn't move is a number, or a
+	codeword, which a number in the range of the codewords on the host is taken to be. Names and
+	strings are written as cells too, which works as both are little endian.
+*/
+static const char* const label_names[] =
+{
+#define defcode( name, flags, label ) #label,
+#define defconst( name, label, value ) #label,
+#define defword( name, flags, label ) #label,
+    DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+};
+
+static const char* const codeword_names[] =
+{
+    "DOCOL",
+    "DODOES",
+#define defcode( name, flags, label ) "code_" #label,
+#define defconst( name, label, value ) "code_" #label,
+#define defword( name, flags, label )
+    DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+};
+
+#define CODEWORD_COUNT ( sizeof( codeword_names ) / sizeof( codeword_names[0] ) )
+
+/* Prints the cell at addr in the first run, which is value there and moved in the second run. */
+static void write_cell( const system_t* first, ucell_t shift, ucell_t addr, cell_t value, cell_t moved )
+{
+    int label;
+    if( value == moved ) {
+        if( (ucell_t) value >= CODE_SPACE && (ucell_t) value < CODE_SPACE + CODEWORD_COUNT ) {
+            printf( "\t.int %s\n", codeword_names[value - CODE_SPACE] );
+        } else {
+            printf( "\t.int %d\n", value );
+        }
+        return;
+    }
+    if( (ucell_t) ( moved - value ) == shift ) {
+        if( (ucell_t) value >= first->data_segment && (ucell_t) value <= first->dp ) {
+            printf( "\t.int forthright_image+%u\n", value - first->data_segment );
+            return;
+        }
+        // The second run laid down the built-in words too.
+        if( (ucell_t) moved == builtin_latest ) {
+            printf( "\t.int previous_word_link\n" );	// the last word of the device dictionary
+            return;
+        }
+        for( label = 0; label < LABEL_COUNT; label++ ) {
+            if( (ucell_t) moved == cfa[label] ) {
+                printf( "\t.int %s\n", label_names[label] );
+                return;
+            }
+            if( (ucell_t) moved == nfa[label] ) {
+                printf( "\t.int name_%s\n", label_names[label] );
+                return;
+            }
+        }
+    }
+    fprintf( stderr, "Can't relocate %d at %u in the image\n", value, addr - first->data_segment );
+    exit( 1 );
+}
+
+/* Prints the dictionary compiled by the first run, after the built-in words, as gas source. The
+   second run is the current one. */
+void forthright_write_image( const system_t* first )
+{
+    const uint8_t* first_mem = (const uint8_t*) first;
+    ucell_t shift = sys->data_segment - first->data_segment;
+    ucell_t end = ( first->dp + 3 ) & ~3;
+    ucell_t addr;
+
+    printf( "/* Generated from forthright.f by arch/host/target/forthright-image, do not edit. */\n\n" );
+    printf( "\t.section .rodata\n" );
+    printf( "\t.align 4\n" );
+    printf( "forthright_image:\n" );
+    for( addr = first->data_segment; addr < end; addr += 4 ) {
+        cell_t value;
+        ucell_t header;
+        for( header = first->latest; header >= first->data_segment; ) {
+            if( header == addr ) {
+                char name[F_LENMASK + 1];
+                snprintf( name, sizeof( name ), "%.*s", first_mem[header + 4] & F_LENMASK, first_mem + header + 5 );
+                if( strstr( name, "*/" ) == 0 ) {
+                    printf( "\n\t/* %s */\n", name );
+                }
+            }
+            memcpy( &header, first_mem + header, sizeof( cell_t ) );
+        }
+        memcpy( &value, first_mem + addr, sizeof( cell_t ) );
+        write_cell( first, shift, addr, value, fetch( addr + shift ) );
+    }
+    printf( "forthright_image_end:\n\n" );
+    printf( "\t.set forthright_image_latest, forthright_image+%u\n", first->latest - first->data_segment );
+    printf( "\t.section .irom0.text\n" );
+}
+#endif
+
+static cell_t ticks( int msb )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    uint64_t ns = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+    return msb ? ns >> 32 : ns;
+}
+
+/*
+	STACK GUARDS ----------------------------------------------------------------------
+
+	INTERPRET checks the canary below each stack, and DSP and RSP against the top, as in esp8266.S.
+
+	On the host each stack also ends a page, and the pages either side are PROT_NONE while Forth
+	runs. Reading past the top of the data stack does no harm, so that page is opened up and the
+	access goes ahead, for INTERPRET to report. Past the others, Forth would overwrite what lies
+	beyond the stack or return to what was never pushed, so both stacks are dropped and Forth
+	starts over from QUIT, which reports the fault at its first INTERPRET.
+*/
+static volatile sig_atomic_t stack_fault;	// found by a guard page, for INTERPRET
+
+static struct
+{
+    ucell_t page;
+    cell_t fault;			// the THROW code
+    int resume;				// 1 if the access can go ahead
+} guard_pages[4];
+
+static void guard_page_fault( int signal_number, siginfo_t* info, void* context )
+{
+    ptrdiff_t addr = (uint8_t*) info->si_addr - mem;
+    unsigned int i;
+    for( i = 0; i < sizeof( guard_pages ) / sizeof( guard_pages[0] ); i++ ) {
+        if( addr >= guard_pages[i].page && addr < guard_pages[i].page + STACK_PAGE_SIZE ) {
+            if( stack_fault == 0 ) {
+                stack_fault = guard_pages[i].fault;
+            }
+            if( !guard_pages[i].resume ) {
+                longjmp( exit_to_c, 1 );		// with stack_fault set, to start over
+            }
+            mprotect( mem + guard_pages[i].page, STACK_PAGE_SIZE, PROT_READ | PROT_WRITE );
+            return;
+        }
+    }
+    signal( SIGSEGV, SIG_DFL );			// not a guard page, so crash when it is retried
+}
+
+static void guard_stacks( int protection )
+{
+    ucell_t data_top = sys->data_stack + sys->data_stack_size;
+    ucell_t return_top = sys->return_stack + sys->return_stack_size;
+    unsigned int i;
+    if( sysconf( _SC_PAGESIZE ) != STACK_PAGE_SIZE || ( (uintptr_t) mem + data_top ) % STACK_PAGE_SIZE != 0
+            || ( (uintptr_t) mem + return_top ) % STACK_PAGE_SIZE != 0 ) {
+        return;					// not laid out for it, the canaries will have to do
+    }
+    if( guard_pages[0].page == 0 ) {			// the first time
+        struct sigaction action;
+        memset( &action, 0, sizeof( action ) );
+        action.sa_sigaction = guard_page_fault;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;	// as it longjmp()s out of the handler
+        sigaction( SIGSEGV, &action, NULL );
+    }
+    guard_pages[0].page = data_top - 2 * STACK_PAGE_SIZE;
+    guard_pages[0].fault = -3;
+    guard_pages[1].page = data_top;
+    guard_pages[1].fault = -4;
+    guard_pages[1].resume = 1;
+    guard_pages[2].page = return_top - 2 * STACK_PAGE_SIZE;
+    guard_pages[2].fault = -5;
+    guard_pages[3].page = return_top;
+    guard_pages[3].fault = -6;
+    for( i = 0; i < sizeof( guard_pages ) / sizeof( guard_pages[0] ); i++ ) {
+        mprotect( mem + guard_pages[i].page, STACK_PAGE_SIZE, protection );
+    }
+}
+
+/* The THROW code of the stack fault since the last INTERPRET, or 0. After one, the canaries and
+   guard pages are put back for the next. */
+static cell_t _STACK_GUARD( ucell_t dsp, ucell_t rsp )
+{
+    cell_t fault = stack_fault;
+    if( fault == 0 ) {
+        if( fetch( sys->data_stack - 4 ) != STACK_CANARY ) {
+            fault = -3;				// data stack overflow
+        } else if( dsp > sys->data_stack + sys->data_stack_size ) {
+            fault = -4;				// data stack underflow
+        } else if( fetch( sys->return_stack - 4 ) != STACK_CANARY ) {
+            fault = -5;				// return stack overflow
+        } else if( rsp > sys->return_stack + sys->return_stack_size ) {
+            fault = -6;				// return stack underflow
+        } else {
+            return 0;
+        }
+    }
+    stack_fault = 0;
+    store( sys->data_stack - 4, STACK_CANARY );
+    store( sys->return_stack - 4, STACK_CANARY );
+    guard_stacks( PROT_NONE );
+    return fault;
+}
+
+void forthright_start( system_t* system )
+{
+    ucell_t ip;			// a14 Forth Instruction pointer
+    ucell_t rsp;		// a13 Forth Return Stack pointer
+    ucell_t dsp;		// a15 Forth Data Stack pointer
+    cell_t tos = 0;		// a7  Top of the data stack
+    cell_t popped;		// work register of POPDATASTACK
+    ucell_t w;			// a8  codeword pointer
+    cell_t a, b, c, d;		// work registers
+    cell_t stats[3];		// HEAP-STATS
+
+    sys = system;
+    mem = (uint8_t*) system;
+    source_position = forthright_source;
+
+    sys->dp = sys->data_segment;
+    sys->latest = lay_down_dictionary();
+    builtin_latest = sys->latest;
+    cold_start = sys->dp;				// High-level code without a codeword.
+    _COMMA( cfa[QUIT] );
+    sys->data_segment_size -= sys->dp - sys->data_segment;
+    sys->data_segment = sys->dp;
+    sys->segments = 0;
+    forthright_find_segment( sys );
+
+    rsp = sys->return_stack + sys->return_stack_size;	// set up the return stack
+    dsp = sys->data_stack + sys->data_stack_size;	// set up data stack
+    sys->s0 = dsp - 4;					// save beginning of stack, the cell for tos
+    sys->currkey = sys->input_buffer;
+    sys->bufftop = sys->input_buffer;
+    sys->base = 10;
+    sys->echo = 0;					// Will be enabled at end of parsing default Forth code.
+    sys->dictionary_indexed = 0;			// The first (FIND) builds the dictionary index.
+    sys->initializing = -1;
+    ip = cold_start;
+
+    guard_stacks( PROT_NONE );
+    while( setjmp( exit_to_c ) != 0 ) {
+        if( stack_fault == 0 ) {
+            guard_stacks( PROT_READ | PROT_WRITE );
+#ifdef FORTHRIGHT_PROFILE
+            print_profile();
+#endif
+            return;					// Error or end of input: exit the program.
+        }
+        rsp = sys->return_stack + sys->return_stack_size;	// Past a guard page: start over,
+        dsp = sys->data_stack + sys->data_stack_size;	// and INTERPRET reports stack_fault.
+        tos = 0;
+        ip = cold_start;
+    }
+
+    for( ;; ) {
+        /* NEXT */
+        w = fetch( ip );
+        ip += 4;
+dispatch:
+#ifdef FORTHRIGHT_PROFILE
+        profile( w, w >= CODE_SPACE ? w : fetch( w ) );
+#endif
+#ifdef FORTHRIGHT_DTC
+        // A cell in CODE_SPACE is a primitive compiled direct threaded, and is its own codeword.
+        switch( w >= CODE_SPACE ? w : fetch( w ) ) {
+#else
+        switch( fetch( w ) ) {
+#endif
+
+        case DOCOL:
+            PUSHRSP( ip );		// push Instruction Pointer on to the return stack
+            ip = w + 4;			// w points to codeword, so make IP point to first data word
+            break;
+
+        case DODOES:
+            a = fetch( w + 4 );		// get Behavior Word
+            if( a != 0 ) {
+                PUSHRSP( ip );
+                ip = a;
+            }
+            PUSHDATASTACK( w + 8 );
+            break;
+
+        case code_DROP:
+            tos = fetch( dsp );		// drop top of stack
+            dsp += 4;
+            break;
+
+        case code_SWAP:
+            a = READTOSX();
+            b = READTOSY();
+            WRITETOSX( b );
+            WRITETOSY( a );
+            break;
+
+        case code_DUP:
+            a = READTOSX();
+            PUSHDATASTACK( a );
+            break;
+
+        case code_OVER:
+            a = READTOSY();
+            PUSHDATASTACK( a );
+            break;
+
+        case code_ROT:
+            a = READTOSX();
+            b = READTOSY();
+            c = READTOSZ();
+            WRITETOSZ( b );
+            WRITETOSY( a );
+            WRITETOSX( c );
+            break;
+
+        case code_NROT:
+            a = READTOSX();
+            b = READTOSY();
+            c = READTOSZ();
+            WRITETOSZ( a );
+            WRITETOSY( c );
+            WRITETOSX( b );
+            break;
+
+        case code_TWODROP:
+            tos = fetch( dsp + 4 );
+            dsp += 8;
+            break;
+
+        case code_TWODUP:
+            b = READTOSY();
+            a = READTOSX();
+            PUSHDATASTACK( b );
+            PUSHDATASTACK( a );
+            break;
+
+        case code_TWOSWAP:
+            a = READTOSX();
+            b = READTOSY();
+            c = READTOSZ();
+            d = READTOST();
+            WRITETOSX( c );
+            WRITETOSY( d );
+            WRITETOSZ( a );
+            WRITETOST( b );
+            break;
+
+        case code_QDUP:
+            a = READTOSX();
+            if( a != 0 ) {
+                PUSHDATASTACK( a );
+            }
+            break;
+
+        case code_INCR:
+            WRITETOSX( READTOSX() + 1 );
+            break;
+
+        case code_DECR:
+            WRITETOSX( READTOSX() - 1 );
+            break;
+
+        case code_INCR4:
+            WRITETOSX( READTOSX() + 4 );
+            break;
+
+        case code_DECR4:
+            WRITETOSX( READTOSX() - 4 );
+            break;
+
+        case code_ADD:
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() + a );
+            break;
+
+        case code_SUB:
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() - a );
+            break;
+
+        case code_MUL:
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() * a );
+            break;
+
+        case code_UDIVMOD:
+            b = POPDATASTACK();			// pop denominator
+            a = POPDATASTACK();			// pop numerator
+            PUSHDATASTACK( forthright_modulo( a, b ) );	// push remainder
+            PUSHDATASTACK( forthright_divide( a, b ) );	// push quotient
+            break;
+
+        case code_DIV:
+            b = POPDATASTACK();			// pop denominator
+            a = POPDATASTACK();			// pop numerator
+            PUSHDATASTACK( forthright_divide( a, b ) );
+            break;
+
+        case code_MOD:
+            b = POPDATASTACK();			// pop denominator
+            a = POPDATASTACK();			// pop numerator
+            PUSHDATASTACK( forthright_modulo( a, b ) );
+            break;
+
+        case code_EQU:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() == a ? -1 : 0 );
+            break;
+
+        case code_NEQU:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() != a ? -1 : 0 );
+            break;
+
+        case code_LT:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() < a ? -1 : 0 );
+            break;
+
+        case code_GT:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() > a ? -1 : 0 );
+            break;
+
+        case code_LE:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() <= a ? -1 : 0 );
+            break;
+
+        case code_GE:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() >= a ? -1 : 0 );
+            break;
+
+        case code_ZEQU:
+            WRITETOSX( READTOSX() == 0 ? -1 : 0 );
+            break;
+
+        case code_ZNEQU:
+            WRITETOSX( READTOSX() != 0 ? -1 : 0 );
+            break;
+
+        case code_ZLT:
+            WRITETOSX( READTOSX() < 0 ? -1 : 0 );
+            break;
+
+        case code_ZGT:
+            WRITETOSX( READTOSX() > 0 ? -1 : 0 );
+            break;
+
+        case code_ZLE:
+            WRITETOSX( READTOSX() <= 0 ? -1 : 0 );
+            break;
+
+        case code_ZGE:
+            WRITETOSX( READTOSX() >= 0 ? -1 : 0 );
+            break;
+
+        case code_AND:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() & a );
+            break;
+
+        case code_OR:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() | a );
+            break;
+
+        case code_XOR:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() ^ a );
+            break;
+
+        case code_INVERT:
+            WRITETOSX( ~READTOSX() );
+            break;
+
+        case code_SHIFTL:			// the shift amount register only takes 5 bits
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() << ( a & 31 ) );
+            break;
+
+        case code_SHIFTR:
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() >> ( a & 31 ) );
+            break;
+
+        case code_SHIFTRA:
+            a = POPDATASTACK();
+            WRITETOSX( READTOSX() >> ( a & 31 ) );
+            break;
+
+        case code_EXIT:
+            ip = POPRSP();		// pop return stack into instruction pointer
+            break;
+
+        case code_LIT:
+            a = fetch( ip );		// get next value where instruction pointer is pointing to
+            ip += 4;			// skip literal value
+            PUSHDATASTACK( a );
+            break;
+
+        case code_STORE:
+            a = POPDATASTACK();		// address to store at
+            b = POPDATASTACK();		// data to store there
+            store( a, b );
+            break;
+
+        case code_FETCH:
+            a = POPDATASTACK();
+            PUSHDATASTACK( fetch( a ) );
+            break;
+
+        case code_ADDSTORE:
+            a = POPDATASTACK();		// address
+            b = POPDATASTACK();		// the amount to add
+            store( a, (ucell_t) fetch( a ) + b );
+            break;
+
+        case code_SUBSTORE:
+            a = POPDATASTACK();		// address
+            b = POPDATASTACK();		// the amount to subtract
+            store( a, (ucell_t) fetch( a ) - b );
+            break;
+
+        case code_STOREBYTE:
+            a = POPDATASTACK();		// address to store at
+            b = POPDATASTACK();		// data to store there
+            BYTE( a ) = b;
+            break;
+
+        case code_FETCHBYTE:
+            a = POPDATASTACK();
+            PUSHDATASTACK( BYTE( a ) );
+            break;
+
+        case code_CCOPY:
+            a = READTOSX();		// destination address
+            b = READTOSY();		// source address
+            BYTE( a ) = BYTE( b );
+            WRITETOSX( a + 1 );
+            WRITETOSY( b + 1 );
+            break;
+
+        case code_CMOVE:
+            a = POPDATASTACK();		// length
+            b = POPDATASTACK();		// destination address
+            c = POPDATASTACK();		// source address
+            while( a-- > 0 ) {
+                BYTE( b++ ) = BYTE( c++ );
+            }
+            break;
+
+        case code_STATE:
+            PUSHDATASTACK( offsetof( system_t, state ) );
+            break;
+
+        case code_DP:
+            sys->peephole_at = 0;	// HERE may be a branch target, so no peephole across it
+            PUSHDATASTACK( offsetof( system_t, dp ) );
+            break;
+
+        case code_DS0:
+            PUSHDATASTACK( sys->data_segment );
+            break;
+
+        case code_DS_SIZE:
+            PUSHDATASTACK( forthright_data_segment_size( sys ) );	// with the chained segments
+            break;
+
+        case code_DS_END:
+            forthright_find_segment( sys );		// the end of the segment that DP is in
+            PUSHDATASTACK( sys->segment_end );
+            break;
+
+        case code_SEGMENT_CHUNK:
+            PUSHDATASTACK( offsetof( system_t, segment_chunk ) );
+            break;
+
+        case code_LATEST:
+            PUSHDATASTACK( offsetof( system_t, latest ) );
+            break;
+
+        case code_S0:
+            PUSHDATASTACK( offsetof( system_t, s0 ) );
+            break;
+
+        case code_BASE:
+            PUSHDATASTACK( offsetof( system_t, base ) );
+            break;
+
+        case code___DOCOL:
+            PUSHDATASTACK( DOCOL );
+            break;
+
+#define defcode( name, flags, label )
+#define defconst( name, label, value ) case code_##label: PUSHDATASTACK( value ); break;
+#define defword( name, flags, label )
+        DICTIONARY
+#undef defcode
+#undef defconst
+#undef defword
+
+        case code_RZ:
+            PUSHDATASTACK( sys->return_stack + sys->return_stack_size );
+            break;
+
+        case code_TOR:
+            a = POPDATASTACK();
+            PUSHRSP( a );
+            break;
+
+        case code_FROMR:
+            a = POPRSP();
+            PUSHDATASTACK( a );
+            break;
+
+        case code_RSPFETCH:
+            PUSHDATASTACK( rsp );
+            break;
+
+        case code_RSPSTORE:
+            rsp = POPDATASTACK();
+            break;
+
+        case code_RDROP:
+            rsp += 4;
+            break;
+
+        case code_DSPFETCH:
+            dsp -= 4;
+            store( dsp, tos );		// spill tos, so the whole stack is in memory
+            tos = dsp;			// and push where it went
+            break;
+
+        case code_DSPSTORE:
+            dsp = tos + 4;		// the new stack pointer is in tos
+            tos = fetch( tos );		// and the new tos is where it points
+            break;
+
+        case code_KEY:
+            a = _KEY();
+            PUSHDATASTACK( a );
+            break;
+
+        case code_EMIT:
+            forthright_putChar( POPDATASTACK() );
+            break;
+
+        case code_WORD:
+            a = _WORD( &b );
+            PUSHDATASTACK( a );		// push base address
+            PUSHDATASTACK( b );		// push length
+            break;
+
+        case code_NUMBER:
+            b = POPDATASTACK();		// length of string
+            a = POPDATASTACK();		// start address of string
+            a = _NUMBER( a, b, &c );
+            PUSHDATASTACK( a );		// parsed number
+            PUSHDATASTACK( c );		// number of unparsed characters (0 = no error)
+            break;
+
+        case code_PAREN_FIND:
+            b = POPDATASTACK();		// length
+            a = POPDATASTACK();		// address
+            PUSHDATASTACK( _FIND( a, b ) );
+            break;
+
+        case code_TCFA:
+            a = POPDATASTACK();
+            PUSHDATASTACK( _TCFA( a ) );
+            break;
+
+        case code_HEADER_COMMA:
+            a = sys->dp;		// the address of the header
+            if( ( a < sys->segment_start || a + DATA_SEGMENT_SLACK > sys->segment_end )
+                && forthright_make_room( sys ) < 0 ) {
+                // at this point, we have exhausted the data segment,
+                // report it and refuse to accept the definition.
+                print_text( "Error: Data segment is full!" );
+                break;
+            }
+            a = sys->dp;		// in a new segment, maybe
+            store( a, sys->latest );	// store link pointer in the header.
+            b = POPDATASTACK();		// length
+            BYTE( a + 4 ) = b;		// Store the length/flags byte.
+            c = POPDATASTACK();		// address of name
+            memmove( mem + a + 5, mem + c, b );
+            d = ( a + b + 8 ) & ~3;	// padding to the codeword
+            memset( mem + a + 5 + b, 0, d - a - 5 - b );
+            sys->latest = a;		// update the LATEST location.
+            sys->dp = d;		// update new datasegment pointer
+            _RELOCATABLE( a );		// The link, and the first instruction or DODOES behaviour
+            _RELOCATABLE( d + 4 );	// pointer, hold addresses, see ROM{.
+            _INDEX_HEADER( a );
+            break;
+
+        case code_COMMA:
+            if( !_ROOM( 4 ) ) {
+                goto dictionary_overflow;
+            }
+            _COMMA( POPDATASTACK() );
+            break;
+
+        case code_COMPILE_COMMA:
+            if( !_ROOM( 4 ) ) {
+                goto dictionary_overflow;
+            }
+            _COMPILE_COMMA( POPDATASTACK() );
+            break;
+
+        case code_ALLOT:
+            if( !_ROOM( READTOSX() ) ) {
+                goto dictionary_overflow;
+            }
+            sys->dp += POPDATASTACK();
+            break;
+
+        dictionary_overflow:
+            // What , ALLOT or the compiler would lay down doesn't fit in the segment, so THROW -8,
+            // dictionary overflow. Before THROW is defined, report it, empty the data stack with
+            // the argument of the word, leave the definition being compiled and go back to QUIT,
+            // which empties the return stack.
+            PUSHDATASTACK( -8 );
+            memcpy( mem + sys->word_buffer, "throw", 5 );
+            c = _FIND( sys->word_buffer, 5 );
+            if( c != 0 ) {
+                w = _TCFA( c );
+                goto dispatch;
+            }
+            print_text( "Error: Data segment is full!" );
+            dsp = sys->data_stack + sys->data_stack_size;
+            tos = 0;
+            sys->state = 0;
+            ip = cold_start;
+            break;
+
+        case code_LBRAC:
+            sys->state = 0;
+            break;
+
+        case code_RBRAC:
+            sys->state = 1;
+            break;
+
+        case code_IMMEDIATE:
+            BYTE( sys->latest + 4 ) ^= F_IMMED;		// Toggle the IMMED bit.
+            break;
+
+        case code_INLINE:
+            BYTE( sys->latest + 4 ) ^= F_INLINE;		// Toggle the INLINE bit.
+            break;
+
+        case code_PAREN_INLINE:
+            if( !_ROOM( _INLINE_SIZE( READTOSX() ) ) ) {
+                goto dictionary_overflow;
+            }
+            _INLINE( POPDATASTACK() );
+            break;
+
+        case code_HIDDEN:
+            a = POPDATASTACK();
+            BYTE( a + 4 ) ^= F_HIDDEN;			// Toggle the HIDDEN bit.
+            break;
+
+        case code_BRACKET_TICK:
+            a = fetch( ip );		// get the address of the next word
+            ip += 4;			// and skip it.
+            PUSHDATASTACK( a );
+            break;
+
+        case code_BRANCH:
+            ip += fetch( ip );		// add the offset to the instruction pointer
+            break;
+
+        case code_ZBRANCH:
+            if( POPDATASTACK() == 0 ) {
+                ip += fetch( ip );	// top of stack is zero, so branch
+            } else {
+                ip += 4;		// otherwise we need to skip the offset
+            }
+            break;
+
+        case code_LITADD:		// LIT n +
+            a = fetch( ip );
+            ip += 4;
+            WRITETOSX( (ucell_t) READTOSX() + a );
+            break;
+
+        case code_FETCHADD:		// @ +
+            a = POPDATASTACK();
+            WRITETOSX( (ucell_t) READTOSX() + fetch( a ) );
+            break;
+
+        case code_EQU_ZBRANCH:		// = 0BRANCH
+            b = POPDATASTACK();
+            a = POPDATASTACK();
+            if( a != b ) {
+                ip += fetch( ip );	// not equal, so branch
+            } else {
+                ip += 4;
+            }
+            break;
+
+        case code_ZEQU_ZBRANCH:		// 0= 0BRANCH
+            if( POPDATASTACK() != 0 ) {
+                ip += fetch( ip );	// not zero, so branch
+            } else {
+                ip += 4;
+            }
+            break;
+
+        case code_QDUP_ZBRANCH:		// ?DUP 0BRANCH
+            if( READTOSX() == 0 ) {
+                tos = fetch( dsp );	// zero is not duplicated, so drop it and branch
+                dsp += 4;
+                ip += fetch( ip );
+            } else {
+                ip += 4;		// the non-zero is kept
+            }
+            break;
+
+        case code_LITSTRING:
+            a = fetch( ip );		// get the length of the string
+            ip += 4;
+            PUSHDATASTACK( ip );	// push the address of the start of the string
+            PUSHDATASTACK( a );		// push length on the stack
+            ip = ( ip + a + 3 ) & ~3;	// skip past the string, and align
+            break;
+
+        case code_TELL:
+            b = POPDATASTACK();
+            a = POPDATASTACK();
+            forthright_putChars( (char*) mem + a, b );
+            break;
+
+        case code_FLUSH:
+            forthright_flush();
+            break;
+
+        case code_ECHO:
+            sys->echo = POPDATASTACK();
+            break;
+
+        case code_INTERPRET:
+            a = _STACK_GUARD( dsp, rsp );
+            if( a != 0 ) {
+                // A stack overflowed or underflowed since the last word. What is on that stack
+                // can't be trusted after that, so empty it, and run STACK-FAULT with the code.
+                if( a == -3 || a == -4 ) {
+                    dsp = sys->data_stack + sys->data_stack_size;
+                } else {
+                    rsp = sys->return_stack + sys->return_stack_size;
+                }
+                PUSHDATASTACK( a );
+                memcpy( mem + sys->word_buffer, "stack-fault", 11 );
+                c = _FIND( sys->word_buffer, 11 );
+                if( c != 0 ) {
+                    w = _TCFA( c );
+                    goto dispatch;
+                }
+                a = POPDATASTACK();		// Not defined yet, so just carry on.
+                break;
+            }
+            a = _WORD( &b );
+            sys->interpret_is_lit = 0;		// Not a literal number (not yet anyway ...)
+            c = _FIND( a, b );
+            if( c != 0 ) {
+                // In the dictionary.  Is it an IMMEDIATE codeword?
+                d = BYTE( c + 4 ) & ( F_IMMED | F_INLINE );
+                w = _TCFA( c );
+            } else {
+                // Not in the dictionary (not a word) so assume it's a literal number.
+                sys->interpret_is_lit++;
+                c = _NUMBER( a, b, &d );
+                if( d != 0 ) {
+                    // Parse error (not a known word or a number in the current BASE).
+                    print_text( "Error at: " );
+                    forthright_putChars( (char*) mem + a, b );
+                    print_text( "\n" );
+                    break;
+                }
+                d = 0;
+                w = cfa[LIT];
+            }
+            if( !( d & F_IMMED ) && sys->state != 0 ) {
+                // Compiling - just append the word to the current dictionary definition.
+                if( ( d & F_INLINE ) && fetch( w ) == DOCOL ) {
+                    if( !_ROOM( _INLINE_SIZE( w ) ) ) {
+                        goto dictionary_overflow;
+                    }
+                    _INLINE( w );		// or its body, if it is flagged INLINE.
+                    break;
+                }
+                if( !_ROOM( sys->interpret_is_lit ? 8 : 4 ) ) {
+                    goto dictionary_overflow;	// with room for LIT and the number after it
+                }
+                _COMPILE_COMMA( w );
+                if( sys->interpret_is_lit ) {
+                    _COMMA( c );		// LIT is followed by the number.
+                    sys->peephole_end = sys->dp;
+                }
+                break;
+            }
+            // Executing - run it!
+            if( sys->interpret_is_lit ) {
+                PUSHDATASTACK( c );
+                break;
+            }
+            // This never returns, but the codeword will eventually do NEXT which will
+            // reenter the loop in QUIT.
+            goto dispatch;
+
+        case code_TWOMUL:
+            WRITETOSX( (ucell_t) READTOSX() << 1 );
+            break;
+
+        case code_TWODIV:
+            WRITETOSX( READTOSX() >> 1 );
+            break;
+
+        case code_PAREN_DO:
+            a = POPDATASTACK();		// index
+            b = POPDATASTACK();		// limit
+            PUSHRSP( b );
+            PUSHRSP( a );
+            break;
+
+        case code_PAREN_LOOP:
+            a = fetch( rsp ) + 1;	// index
+            b = fetch( rsp + 4 );	// limit
+            if( a == b ) {
+                rsp += 8;
+                ip += 4;		// Advance instruction pointer
+            } else {
+                store( rsp, a );
+                ip += fetch( ip );	// add the offset to the instruction pointer
+            }
+            break;
+
+        case code_PAREN_PLUS_LOOP:
+            b = fetch( rsp + 4 );	// limit
+            a = fetch( rsp ) - b;	// index-limit
+            c = (ucell_t) a + POPDATASTACK();	// index-limit+n
+            if( ( c ^ a ) < 0 ) {	// (index-limit) and (index-limit+n) have different sign?
+                rsp += 8;
+                ip += 4;		// advance instruction pointer
+            } else {
+                store( rsp, (ucell_t) c + b );	// index+n
+                ip += fetch( ip );
+            }
+            break;
+
+        case code_UNLOOP:
+            rsp += 8;
+            break;
+
+        case code_I:
+            PUSHDATASTACK( fetch( rsp ) );
+            break;
+
+        case code_J:
+            PUSHDATASTACK( fetch( rsp + 8 ) );
+            break;
+
+        case code_LSEEK:
+        case code_READ:
+        case code_FWRITE:
+        case code_FOPEN:
+        case code_FCLOSE:
+        case code_FDIRLIST:
+            break;			// No filesystem yet, same as on the device.
+
+        case code_SAVE_IMAGE:
+            b = POPDATASTACK();		// length of file name
+            a = POPDATASTACK();		// file name
+            PUSHDATASTACK( forthright_save_image( sys, (char*) mem + a, b ) );
+            break;
+
+        case code_LOAD_IMAGE:
+            b = POPDATASTACK();
+            a = POPDATASTACK();
+            PUSHDATASTACK( forthright_load_image( sys, (char*) mem + a, b ) );
+            break;
+
+        case code_ROM_BEGIN:
+            PUSHDATASTACK( forthright_rom_begin( sys ) );
+            break;
+
+        case code_ROM_END:
+            PUSHDATASTACK( forthright_rom_end( sys ) );
+            break;
+
+        case code_ALLOCATE:		// ( u -- a-addr ior )
+            a = forthright_allocate( sys, POPDATASTACK() );
+            PUSHDATASTACK( a );
+            PUSHDATASTACK( a == 0 ? -1 : 0 );
+            break;
+
+        case code_FREE:			// ( a-addr -- ior )
+            PUSHDATASTACK( forthright_free( sys, POPDATASTACK() ) );
+            break;
+
+        case code_RESIZE:		// ( a-addr u -- a-addr' ior ), a-addr' is a-addr if it fails
+            b = POPDATASTACK();
+            a = POPDATASTACK();
+            c = forthright_resize( sys, a, b );
+            PUSHDATASTACK( c == 0 ? a : c );
+            PUSHDATASTACK( c == 0 ? -1 : 0 );
+            break;
+
+        case code_HEAP_STATS:		// ( -- used free largest )
+            forthright_heap_stats( sys, stats );
+            PUSHDATASTACK( stats[0] );
+            PUSHDATASTACK( stats[1] );
+            PUSHDATASTACK( stats[2] );
+            break;
+
+        case code_MARK_ARENA:		// ( -- mark )
+            PUSHDATASTACK( forthright_mark_arena( sys ) );
+            break;
+
+        case code_RELEASE_ARENA:	// ( mark -- ior )
+            PUSHDATASTACK( forthright_release_arena( sys, POPDATASTACK() ) );
+            break;
+
+        case code_CHAR:
+            a = _WORD( &b );
+            PUSHDATASTACK( BYTE( a ) );	// the first character of the word
+            break;
+
+        case code_INITIALIZEDONE:
+            sys->initializing = 0;
+#ifdef FORTHRIGHT_IMAGE
+            longjmp( exit_to_c, 1 );	// forthright.f is compiled, which is all we wanted
+#endif
+            break;
+
+        case code_EXECUTE:
+            w = POPDATASTACK();		// Get xt into w, which may also be a codeword in DTC
+            goto dispatch;		// After xt runs its NEXT will continue executing the current word.
+
+        case code_RDTSC:		// ( -- lsb msb ) nanoseconds on the host
+            PUSHDATASTACK( ticks( 0 ) );
+            PUSHDATASTACK( ticks( 1 ) );
+            break;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ *  Copyright 2016 Niclas Hedhman, All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* The host counterpart of the ESP8266 user_main.c; standard input and output replaces the
+ * serial port and the TCP shell.
+ *
+ *     cat myprog.f - | ./target/forthright
+ *
+ * target/forthright-image prints the ROM image on standard output instead, and what Forth prints
+ * goes to standard error.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "forthright.h"
+
+#ifdef FORTHRIGHT_IMAGE
+#define FORTH_OUTPUT stderr
+#else
+#define FORTH_OUTPUT stdout
+#endif
+
+int main( int argc, char** argv )
+{
+#ifdef FORTHRIGHT_IMAGE
+    forthright_image();
+#else
+    forthright();
+#endif
+    fflush( stdout );
+    return 0;
+}
+
+void forthright_echo_char( char ch )
+{
+}
+
+void forthright_putChar( char ch )
+{
+    fputc( ch, FORTH_OUTPUT );
+}
+
+void forthright_putChars( char* str, int length )
+{
+    fwrite( str, 1, length, FORTH_OUTPUT );
+}
+
+void forthright_flush()
+{
+    fflush( FORTH_OUTPUT );
+}
+
+void forthright_debugOut( char* str, int length )
+{
+    fwrite( str, 1, length, stderr );
+}
+
+/* Reads characters from standard input to the Forth Input Buffer.
+
+   Output is flushed first, so that an interactive user sees the result of the previous line
+   before we block.
+
+   Returns -1 at end of input.
+*/
+int forthright_readChars( char* buffer, int bufsize )
+{
+    fflush( stdout );
+    int bytesRead = read( STDIN_FILENO, buffer, bufsize-1 );
+    if( bytesRead <= 0 ) {
+        return -1;
+    }
+    return bytesRead;
+}
+
+int forthright_divide( int a, int b ) {
+    return a / b;
+}
+
+int forthright_modulo( int a, int b ) {
+    return a % b;
+}
@@ -89,6 +89,10 @@
 : $+! ( addr1 u addr2 -- ) dup $@len $ins ;
 
 
+( Between MARK-ARENA and RELEASE-ARENA, the strings are allocated in the arena and go with it. Clear the
+  variables with OFF before RELEASE-ARENA, as $OFF or $! of a string that is gone will fail. )
+
+
 ( $off releases a string. )
 : $off ( addr -- )  dup @ free throw off ;
 
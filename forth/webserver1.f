@@ -180,11 +180,14 @@ commands set-current
   behind.
 
   Fortunately, Gforth provides nextname, an appropriate tool for this. We construct exactly the
-  string we need and call VARIABLE and CREATE afterwards.
+  string we need and call VARIABLE and CREATE afterwards. The variables are linked together too,
+  for request-off below.
 )
+variable header-values
 : value:  ( -- )  name
     definitions 2dup 1- nextname variable
     values set-current nextname here cell - create ,
+    here header-values @ , header-values !
     definitions  does> @ get-rest
 ;
 
@@ -429,8 +432,19 @@ Top Level Definitions
     then  then  then  outfile-id flush-file throw
 ;
 
+(
+  The strings of a request all go when it is done, so they are allocated in an arena, see
+  MARK-ARENA, and given back at once. The string variables are cleared first, as they would
+  otherwise point into it.
+)
+: request-off ( -- )
+    url off  posted off  url-args off  protocol off
+    header-values @ begin  ?dup while  dup cell - @ off  @ repeat
+;
+
 : httpd  ( n -- )  maxnum !
-    begin  ['] http catch  maxnum @ 0= or  until
+    begin  mark-arena >r  ['] http catch  request-off  r> release-arena drop
+    maxnum @ 0= or  until
 ;
 
 (
@@ -17,15 +17,15 @@
 : '0' [ char 0 ] literal ;
 : '-' [ char - ] literal ;
 : '.' [ char . ] literal ;
-: [compile] immediate word (find) >cfa , ;
-: recurse immediate latest @ >cfa , ;
-: if immediate ['] 0branch , here 0 , ;
+: [compile] immediate word (find) >cfa compile, ;
+: recurse immediate latest @ >cfa compile, ;
+: if immediate ['] 0branch compile, here 0 , ;
 : then immediate dup here swap - swap ! ;
 : else immediate ['] branch , here 0 , swap dup here swap - swap ! ;
 : begin immediate here ;
-: until immediate ['] 0branch , here - , ;
+: until immediate ['] 0branch compile, here - , ;
 : again immediate ['] branch , here - , ;
-: while immediate ['] 0branch , here swap 0 , ;
+: while immediate ['] 0branch compile, here swap 0 , ;
 : repeat immediate ['] branch , here - , dup here swap - swap ! ;
 : unless immediate ['] not , [compile] if ;
 : ( immediate
@@ -185,7 +185,6 @@
 ;
 
 : constant word header, docol , ['] lit , , ['] exit , ;
-: allot dp +! ;
 : cells 4 * ;
 : variable word header,	dodoes , 0 , 1 cells allot ;
 : create word header, dodoes , 0 , ;
@@ -292,8 +291,8 @@
 ;
 
 : of immediate
-	['] over ,
-	['] = ,
+	['] over compile,
+	['] = compile,
 	[compile] if
 	['] drop ,
 ;
@@ -414,6 +413,16 @@ leave-sp leave-sp !
 	; immediate
 
 : cfa>
+	latest @
+	begin
+		?dup
+	while
+		2dup >cfa @ = if
+			nip
+			exit
+		then
+		@
+	repeat
 	latest @
 	begin
 		?dup
@@ -473,6 +482,29 @@ leave-sp leave-sp !
 			.
 			." ) "
 		endof
+		['] lit+ of
+			." lit+ "
+			4 + dup @
+			.
+		endof
+		['] =0branch of
+			." =0branch ( "
+			4 + dup @
+			.
+			." ) "
+		endof
+		['] 0=0branch of
+			." 0=0branch ( "
+			4 + dup @
+			.
+			." ) "
+		endof
+		['] ?dup0branch of
+			." ?dup0branch ( "
+			4 + dup @
+			.
+			." ) "
+		endof
 		['] branch of
 			." branch ( "
 			4 + dup @
@@ -546,6 +578,10 @@ leave-sp leave-sp !
 	cr
 ;
 
+( INTERPRET runs this when a stack overflowed, -3 and -5, or underflowed, -4 and -6, since the
+  word before, with the data stack emptied for -3 and -4. See STACK GUARDS in esp8266.S. )
+: stack-fault ( n -- ) print-stack-trace throw ;
+
 : z" immediate
 	state @ if
 		['] litstring ,
@@ -594,14 +630,20 @@ leave-sp leave-sp !
 
 : cstring swap over here swap cmove here + 0 swap c! here ;
 : bye ;
-: unused data-segment-size here data-segment-start - - 4 / ;
-
-cr cr cr
-6 spaces ." Forthright ver 1.0" cr
-." Copyright 2016, Niclas Hedhman" cr
-5 spaces ." All rights reserved." cr cr
-unused . ." cells remaining" cr
-." <ok>" cr
+: unused data-segment-end here - 4 / ;	( in the segment that HERE is in )
+
+( Everything above is compiled into the ROM image of the dictionary, see the host Makefile, and
+  with that the ESP8266 only runs the three lines below at boot. )
+: welcome
+	cr cr cr
+	6 spaces ." Forthright ver 1.0" cr
+	." Copyright 2016, Niclas Hedhman" cr
+	5 spaces ." All rights reserved." cr cr
+	unused . ." cells remaining" cr
+	." <ok>" cr
+;
+
+welcome
 init-done
 true echo ( Enable echo )
 
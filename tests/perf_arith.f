@@ -0,0 +1,59 @@
+( -*- text -*-
+  FORTH repeated OVER + SWAP * 1000, i.e. Fibonacci numbers, using the
+  arithmetic and stack primitives. Same harness as perf_dupdrop.f. )
+
+( Print the time passed. )
+: print-time	( lsb msb lsb msb -- lsb lsb )
+	( The test is very short so likely the MSBs will be the same.  This
+	  makes calculating the time easier (because we can only do 32 bit
+	    subtraction).  So check MSBs are equal. )
+	2 pick <> if
+		." MSBs not equal, please repeat the test" cr
+	else
+		nip
+		swap - u. cr
+	then
+;
+
+: 4drop drop drop drop drop ;
+
+: perform-test	( xt -- )
+	( Get everything in the cache. )
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	0 0 0 0 print-time
+	( Run the test 10 times. )
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	drop
+;
+
+( ---------------------------------------------------------------------- )
+( Make a word which builds the repeated OVER + SWAP sequence. )
+: make-fib	( n -- )
+	begin ?dup while ['] over , ['] + , ['] swap , 1- repeat
+;
+
+( Now the actual test routine. )
+: TEST		( -- startlsb startmsb endlsb endmsb )
+	rdtsc			( Start time )
+	2>r 0 1
+	[ 1000 make-fib ]	( 1000 * OVER + SWAP )
+	2drop 2r>
+	rdtsc			( End time )
+;
+
+: run ['] TEST perform-test ;
+run
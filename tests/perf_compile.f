@@ -0,0 +1,23 @@
+( -*- text -*-
+  Compile speed, in tokens per second. The host Makefile appends a thousand generated
+  definitions like
+
+	: w17 dup 17 + swap drop ;
+
+  to this file, followed by "rdtsc 8000 report", so what is timed is WORD, (FIND) and
+  compiling, with the dictionary growing as it goes. )
+
+: report	( lsb msb lsb msb tokens -- )
+	>r
+	2 pick <> if
+		." MSBs not equal, please repeat the test" cr
+		drop drop drop r> drop
+	else
+		nip
+		swap - 1000 /		( microseconds )
+		r> 1000 * swap / 1000 *
+		u. ." tokens/s" cr
+	then
+;
+
+rdtsc
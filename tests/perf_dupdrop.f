@@ -3,77 +3,89 @@
   and the assembler primitives.
   $Id: perf_dupdrop.f,v 1.3 2007-10-12 01:46:26 rich Exp $ )
 
-1024 32 * MORECORE
-
 ( Print the time passed. )
-: PRINT-TIME	( lsb msb lsb msb -- lsb lsb )
+: print-time	( lsb msb lsb msb -- lsb lsb )
 	( The test is very short so likely the MSBs will be the same.  This
 	  makes calculating the time easier (because we can only do 32 bit
 	    subtraction).  So check MSBs are equal. )
-	2 PICK <> IF
-		." MSBs not equal, please repeat the test" CR
-	ELSE
-		NIP
-		SWAP - U. CR
-	THEN
+	2 pick <> if
+		." MSBs not equal, please repeat the test" cr
+	else
+		nip
+		swap - u. cr
+	then
 ;
 
-: 4DROP DROP DROP DROP DROP ;
+: 4drop drop drop drop drop ;
 
-: PERFORM-TEST	( xt -- )
+: perform-test	( xt -- )
 	( Get everything in the cache. )
-	DUP EXECUTE 4DROP
-	DUP EXECUTE 4DROP
-	DUP EXECUTE 4DROP
-	DUP EXECUTE 4DROP
-	DUP EXECUTE 4DROP
-	DUP EXECUTE 4DROP
-	0 0 0 0 PRINT-TIME
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	0 0 0 0 print-time
 	( Run the test 10 times. )
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DUP EXECUTE PRINT-TIME
-	DROP
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	drop
 ;
 
 ( ---------------------------------------------------------------------- )
 ( Make a word which builds the repeated DUP DROP sequence. )
-: MAKE-DUPDROP	( n -- )
-	BEGIN ?DUP WHILE ' DUP , ' DROP , 1- REPEAT
+: make-dupdrop	( n -- )
+	begin ?dup while ['] dup , ['] drop , 1- repeat
 ;
 
 ( Now the actual test routine. )
 : TEST		( -- startlsb startmsb endlsb endmsb )
-	RDTSC			( Start time )
-	[ 1000 MAKE-DUPDROP ]	( 1000 * DUP DROP )
-	RDTSC			( End time )
+	rdtsc			( Start time )
+	[ 1000 make-dupdrop ]	( 1000 * DUP DROP )
+	rdtsc			( End time )
 ;
 
-: RUN ['] TEST PERFORM-TEST ;
-RUN
+: run ['] TEST perform-test ;
+run
 
 ( ---------------------------------------------------------------------- )
 ( Try the inlined alternative. )
 
-( Inline the assembler primitive (cfa) n times. )
-: *(INLINE) ( cfa n -- )
-	BEGIN ?DUP WHILE OVER (INLINE) 1- REPEAT DROP
+: dupdrop dup drop ; inline
+
+( Compile n calls to the Forth word xt. )
+: *(call) ( xt n -- )
+	begin ?dup while over , 1- repeat drop
+;
+
+( Inline the Forth word xt n times. )
+: *(inline) ( xt n -- )
+	begin ?dup while over (inline) 1- repeat drop
 ;
 
-: DUPDROP INLINE DUP INLINE DROP ;CODE
+: TEST
+	rdtsc
+	[ ' dupdrop 1000 *(call) ]
+	rdtsc
+;
+
+: run ['] TEST perform-test ;
+run
 
 : TEST
-	INLINE RDTSC
-	[ S" DUPDROP" FIND >CFA 1000 *(INLINE) ]
-	INLINE RDTSC
-;CODE
+	rdtsc
+	[ ' dupdrop 1000 *(inline) ]
+	rdtsc
+;
 
-: RUN ['] TEST PERFORM-TEST ;
-RUN
+: run ['] TEST perform-test ;
+run
@@ -0,0 +1,79 @@
+( -*- text -*-
+  FORTH ALLOCATE and FREE, 100 pairs of each as a web server building a
+  response would: a small string, a larger one, and a RESIZE of the first
+  while the second is held, first on the heap and then in an arena. Same
+  harness as perf_dupdrop.f. )
+
+( Print the time passed. )
+: print-time	( lsb msb lsb msb -- lsb lsb )
+	( The test is very short so likely the MSBs will be the same.  This
+	  makes calculating the time easier (because we can only do 32 bit
+	    subtraction).  So check MSBs are equal. )
+	2 pick <> if
+		." MSBs not equal, please repeat the test" cr
+	else
+		nip
+		swap - u. cr
+	then
+;
+
+: 4drop drop drop drop drop ;
+
+: perform-test	( xt -- )
+	( Get everything in the cache. )
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	0 0 0 0 print-time
+	( Run the test 10 times. )
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	drop
+;
+
+( ---------------------------------------------------------------------- )
+( Now the actual test routine, 100 times around the loop. )
+: TEST		( -- startlsb startmsb endlsb endmsb )
+	rdtsc			( Start time )
+	2>r
+	100 begin ?dup while
+		24 allocate drop 300 allocate drop
+		swap 60 resize drop
+		free drop free drop
+	1- repeat
+	2r>
+	rdtsc			( End time )
+;
+
+: run ['] TEST perform-test ;
+run
+
+( ---------------------------------------------------------------------- )
+( The same in an arena, released at the end as after a request. )
+: TEST		( -- startlsb startmsb endlsb endmsb )
+	rdtsc			( Start time )
+	2>r
+	mark-arena
+	100 begin ?dup while
+		24 allocate drop 300 allocate drop
+		swap 60 resize drop
+		free drop free drop
+	1- repeat
+	release-arena drop
+	2r>
+	rdtsc			( End time )
+;
+
+: run ['] TEST perform-test ;
+run
@@ -0,0 +1,57 @@
+( -*- text -*-
+  FORTH loops as the compiler builds them from source, i.e. with the
+  superinstructions for ?DUP WHILE, LIT +, = UNTIL and 0= IF.
+  Same harness as perf_dupdrop.f. )
+
+( Print the time passed. )
+: print-time	( lsb msb lsb msb -- lsb lsb )
+	( The test is very short so likely the MSBs will be the same.  This
+	  makes calculating the time easier (because we can only do 32 bit
+	    subtraction).  So check MSBs are equal. )
+	2 pick <> if
+		." MSBs not equal, please repeat the test" cr
+	else
+		nip
+		swap - u. cr
+	then
+;
+
+: 4drop drop drop drop drop ;
+
+: perform-test	( xt -- )
+	( Get everything in the cache. )
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	dup execute 4drop
+	0 0 0 0 print-time
+	( Run the test 10 times. )
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	dup execute print-time
+	drop
+;
+
+( ---------------------------------------------------------------------- )
+( Now the actual test routine, 100 times around each loop. )
+: TEST		( -- startlsb startmsb endlsb endmsb )
+	rdtsc			( Start time )
+	2>r
+	100 begin ?dup while -1 + repeat
+	0 begin 1 + dup 100 = until drop
+	0 begin dup 0= if 2 + then 1 + dup 100 = until drop
+	2r>
+	rdtsc			( End time )
+;
+
+: run ['] TEST perform-test ;
+run
@@ -0,0 +1,21 @@
+( -*- text -*- )
+
+variable A variable B variable M variable P
+heap-stats drop nip constant FREE-BEFORE
+
+: TEST
+	mark-arena M !
+	10 allocate . A !  10 allocate . B !
+	B @ A @ - . A @ free . A @ free . cr		( a cell and the size apart, and FREE leaves them be )
+	42 B @ !  B @ 100 resize . B @ = . B @ @ .	( the last one grows where it is )
+	A @ 100 resize . dup A @ <> . A ! cr		( the others move )
+	mark-arena  500 allocate nip .  release-arena .
+	FREE-BEFORE heap-stats drop nip - . cr		( 16, grown to 104, and 104 )
+	M @ release-arena . M @ release-arena .
+	heap-stats drop nip FREE-BEFORE = . cr		( all given back )
+	20 allocate . heap-stats 2drop . free . cr		( and ALLOCATE is back on the heap, in a class of 32 )
+	200 allocate . A !  10 allocate . B !  A @ free .
+	10 allocate . P !  7 P @ !  mark-arena M !
+	P @ 200 resize . dup A @ = . P !  M @ release-arena .	( RESIZE takes the freed block, not the arena )
+	P @ @ .  P @ free .  B @ free . cr
+;
@@ -1,73 +1,73 @@
 ( -*- text -*- )
 
 : TEST
-	1 0 < . CR
-	0 1 < . CR
-	1 -1 < . CR
-	-1 1 < . CR
-	-1 0 < . CR
-	0 -1 < . CR CR
+	1 0 < . cr
+	0 1 < . cr
+	1 -1 < . cr
+	-1 1 < . cr
+	-1 0 < . cr
+	0 -1 < . cr cr
 
-	1 0 > . CR
-	0 1 > . CR
-	1 -1 > . CR
-	-1 1 > . CR
-	-1 0 > . CR
-	0 -1 > . CR CR
+	1 0 > . cr
+	0 1 > . cr
+	1 -1 > . cr
+	-1 1 > . cr
+	-1 0 > . cr
+	0 -1 > . cr cr
 
-	1 1 <= . CR
-	0 0 <= . CR
-	-1 -1 <= . CR
-	1 0 <= . CR
-	0 1 <= . CR
-	1 -1 <= . CR
-	-1 1 <= . CR
-	-1 0 <= . CR
-	0 -1 <= . CR CR
+	1 1 <= . cr
+	0 0 <= . cr
+	-1 -1 <= . cr
+	1 0 <= . cr
+	0 1 <= . cr
+	1 -1 <= . cr
+	-1 1 <= . cr
+	-1 0 <= . cr
+	0 -1 <= . cr cr
 
-	1 1 >= . CR
-	0 0 >= . CR
-	-1 -1 >= . CR
-	1 0 >= . CR
-	0 1 >= . CR
-	1 -1 >= . CR
-	-1 1 >= . CR
-	-1 0 >= . CR
-	0 -1 >= . CR CR
+	1 1 >= . cr
+	0 0 >= . cr
+	-1 -1 >= . cr
+	1 0 >= . cr
+	0 1 >= . cr
+	1 -1 >= . cr
+	-1 1 >= . cr
+	-1 0 >= . cr
+	0 -1 >= . cr cr
 
-	1 1 = . CR
-	1 0 = . CR
-	0 0 = . CR
-	1 -1 = . CR
-	-1 -1 = . CR CR
+	1 1 = . cr
+	1 0 = . cr
+	0 0 = . cr
+	1 -1 = . cr
+	-1 -1 = . cr cr
 
-	1 1 <> . CR
-	1 0 <> . CR
-	0 0 <> . CR
-	1 -1 <> . CR
-	-1 -1 <> . CR CR
+	1 1 <> . cr
+	1 0 <> . cr
+	0 0 <> . cr
+	1 -1 <> . cr
+	-1 -1 <> . cr cr
 
-	1 0= . CR
-	0 0= . CR
-	-1 0= . CR CR
+	1 0= . cr
+	0 0= . cr
+	-1 0= . cr cr
 
-	1 0<> . CR
-	0 0<> . CR
-	-1 0<> . CR CR
+	1 0<> . cr
+	0 0<> . cr
+	-1 0<> . cr cr
 
-	1 0< . CR
-	0 0< . CR
-	-1 0< . CR CR
+	1 0< . cr
+	0 0< . cr
+	-1 0< . cr cr
 
-	1 0> . CR
-	0 0> . CR
-	-1 0> . CR CR
+	1 0> . cr
+	0 0> . cr
+	-1 0> . cr cr
 
-	1 0<= . CR
-	0 0<= . CR
-	-1 0<= . CR CR
+	1 0<= . cr
+	0 0<= . cr
+	-1 0<= . cr cr
 
-	1 0>= . CR
-	0 0>= . CR
-	-1 0>= . CR CR
+	1 0>= . cr
+	0 0>= . cr
+	-1 0>= . cr cr
 ;
@@ -1,12 +1,12 @@
 ( -*- text -*- )
 
-: TEST4 PRINT-STACK-TRACE THROW ;
+: TEST4 print-stack-trace throw ;
 
 : TEST3 0 TEST4 26 TEST4 ;
 
 : TEST2
-	['] TEST3 CATCH
-	?DUP IF ." TEST3 threw exception " . CR THEN
+	['] TEST3 catch
+	?dup if ." TEST3 threw exception " . cr then
 	TEST3
 ;
 
@@ -0,0 +1,32 @@
+( -*- text -*- )
+
+: FOO 1 ;
+: BAR FOO ;
+: FOO FOO 10 + ;
+: TWICE 1 ;
+: TWICE 2 ;
+hide TWICE
+: ONCE 3 ;
+hide ONCE
+: GONE 4 ;
+forget GONE
+: AFTER 5 ;
+
+( The number of words that (FIND) doesn't find by their own name. )
+: NOT-FOUND
+	0 latest @
+	begin ?dup while
+		dup 4+ 1+ over 4+ c@ f_lenmask and (find)
+		over ?hidden if drop else 0= if swap 1+ swap then then
+		@
+	repeat
+;
+
+: TEST
+	FOO . BAR . cr
+	TWICE . cr
+	[ word ONCE (find) ] literal . cr
+	[ word GONE (find) ] literal . cr
+	AFTER . cr
+	NOT-FOUND . cr
+;
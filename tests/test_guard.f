@@ -0,0 +1,28 @@
+( -*- text -*- )
+
+: underflow drop drop drop ;
+: overflow 200 0 do i loop ;
+: runaway begin 0 again ;
+: drain begin drop again ;
+: nest recurse ;
+: deep ( n -- ) ?dup if 1- recurse then ;
+
+1 2 underflow
+depth .
+1 2 overflow
+depth .
+runaway
+depth .
+drain
+depth .
+nest
+depth .
+200 deep
+depth .
+: twice ( n -- 2n ) dup >r r> + ;
+r>
+21 twice .
+nest
+21 twice .
+
+: TEST 1 2 depth . underflow ;
@@ -0,0 +1,17 @@
+( -*- text -*- )
+
+variable A variable B variable C
+
+: TEST
+	100 allocate . A !  100 allocate . B !
+	A @ free . B @ free .  A @ free . cr			( FREE of a freed block fails )
+	100 allocate . A @ = . cr				( the size class is reused )
+	A @ 10 resize . A @ = .					( it fits, so it stays )
+	A @ 3000 resize . A @ = . cr				( at the top, so it grows in place )
+	42 A @ 2996 + !  200 allocate . B !  16 allocate . C !
+	A @ 6000 resize . dup A @ <> . A !  A @ 2996 + @ . cr	( moved, with the data )
+	heap-stats rot 0> . > .					( the old block is a hole )
+	A @ free . B @ free . C @ free . cr
+	heap-stats . . . cr					( largest, free and used: the holes stay apart )
+	-1 allocate nip . 0 allocate . free . 0 free . cr
+;
@@ -0,0 +1,16 @@
+( -*- text -*- )
+
+: KEEP 1 ;
+variable V
+42 V !
+s" target/test_image.img" save-image . cr
+: KEEP 2 ;
+: LOST 3 ;
+99 V !
+s" target/test_image.img" load-image . cr
+s" target/no_such.img" load-image . cr
+
+: TEST
+	KEEP . V @ . cr
+	[ word LOST (find) ] literal . cr
+;
@@ -0,0 +1,14 @@
+( -*- text -*- )
+
+: SQUARE dup * ; inline
+: ABS2 dup 0< if negate then ; inline
+: GREETING ." hello " ; inline
+
+: TEST
+	7 SQUARE . cr
+	-5 ABS2 . 5 ABS2 . cr
+	GREETING cr
+	[ latest @ >dfa 8 + ] literal @ ['] dup = . cr
+	[ latest @ >dfa 12 + ] literal @ ['] * = . cr
+	1 2 3 SQUARE SQUARE . . . cr
+;
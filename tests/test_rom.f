@@ -0,0 +1,25 @@
+( -*- text -*- )
+
+here
+rom{ . cr
+: DOUBLE 2 * ;
+: QUAD DOUBLE DOUBLE ;
+: GREET ." hello" ;
+create TABLE 1 , 2 , 3 ,
+here : STAGED [ dup ] literal ;		( a number that looks like an address in the buffer )
+: FACT ( n -- n! ) dup 1 > if dup 1- recurse * then ;
+: KONST create , does> @ ;
+7 KONST SEVEN
+: grow ( n -- ) 0 do s" filler" header, 200 allot loop ;
+40 grow					( more than a sector )
+: LATER QUAD 1+ ;
+}rom . cr
+STAGED = . cr				( is not moved along to the flash )
+here = . cr				( the data segment is untouched )
+rom{ . rom{ . }rom . }rom . cr		( and they don't nest )
+
+: TEST
+	5 QUAD . 5 LATER . TABLE 8 + @ . GREET cr
+	5 FACT . SEVEN . cr
+	[ word DOUBLE (find) ] literal 0<> . cr
+;
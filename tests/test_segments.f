@@ -0,0 +1,25 @@
+( Run by the host Makefile on target/forthright-small, whose data segment is 16 KB like the
+  ESP8266's. GROW lays down headers until the definitions no longer fit in it. )
+[
+cr ." SEGMENTS" cr
+
+data-segment-size constant ds-before
+: libraries ;
+: grow ( n -- ) 0 do s" filler" header, 200 allot loop ;
+100 grow
+
+data-segment-size ds-before > .		( segments have been chained to the data segment )
+unused 0> .
+: late 42 ; late .
+cr
+
+: too-much segment-chunk @ allot ;
+here ' too-much catch -8 = .	( ALLOT past the end of the segment throws dictionary overflow, )
+here = .			( leaves DP be, )
+: later 43 ; later .		( and a definition still fits after it )
+cr
+
+forget libraries
+data-segment-size ds-before = .		( and FORGET gives them back )
+here data-segment-end < .
+cr
@@ -1,8 +1,8 @@
 ( -*- text -*- )
 
-: TEST4 PRINT-STACK-TRACE ;
+: TEST4 print-stack-trace ;
 
-: TEST3 TEST4 1 2 + . CR TEST4 ;
+: TEST3 TEST4 1 2 + . cr TEST4 ;
 
 : TEST2 TEST3 TEST3 ;
 